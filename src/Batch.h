@@ -0,0 +1,192 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include "pico/time.h"
+
+#include <tuple>
+#include <cstring>
+
+#include "Postman.h"
+#include "Buffer.h"
+#include "Clock.h"
+#include "Message.h"
+#include "Span.h"
+
+namespace Postman {
+
+  /**
+   * Batch of samples with a fixed field layout T..., stored column by column in a pooled Buffer
+   * and published as a single Message. Consumers iterate each column with column<I>(message).
+   * 
+   * Each column holds capacity values, a multiple of 8 so every column is 8 byte aligned. A partial batch
+   * is compacted before it is published, to columns of stride(samples) values, so its Buffer length covers
+   * every column and nothing stale is sent when it is bridged
+  */
+  template<typename... T>
+  class Batch {
+
+    private:
+      /**
+       * Sum of sizeof the first I types of U
+      */
+      template<size_t I, typename... U>
+      struct Prefix {
+        static constexpr size_t size = 0;
+      };
+
+      template<size_t I, typename H, typename... U>
+      struct Prefix<I, H, U...> {
+        static constexpr size_t size = I ? sizeof(H) + Prefix<(I ? I - 1 : 0), U...>::size : 0;
+      };
+
+    public:
+      template<size_t I>
+      using Column = typename std::tuple_element<I, std::tuple<T...>>::type;
+
+      static constexpr size_t row = Prefix<sizeof...(T), T...>::size;
+      static constexpr size_t capacity = (BUFFER_SIZE / row) & ~((size_t) 7);
+      static_assert(capacity > 0, "BUFFER_SIZE is too small for 8 rows of the Batch");
+
+      /**
+       * Message property holding the number of samples in a published batch
+      */
+      static constexpr const char* SAMPLES = "samples";
+
+      /**
+       * Publish a partial batch once it is timeout_ms old, 0 to only publish when full. The age is checked
+       * by append() & poll(), so a producer that may stall should poll() while it waits for samples
+      */
+      explicit Batch(const uint32_t timeout_ms = 0) : _timeout_ms(timeout_ms){}
+
+      /**
+       * Append a sample, publishing the batch once full or timed out
+       * Handler only. Returns false if no Buffer was available and the sample was dropped
+      */
+      bool append(const T&... values){
+        if(!this->_buffer){
+          if(!(this->_buffer = Buffer::create())){
+            return false;
+          }
+          this->_first = Clock::now();
+        }
+
+        this->write<0>(*this->_buffer, this->_count, values...);
+        this->_count++;
+
+        if(this->_count == capacity){
+          this->flush();
+        }
+        else {
+          this->poll();
+        }
+        return true;
+      }
+
+      /**
+       * Publish a partial batch if it has timed out. Returns true if a batch was published
+       * Handler only
+      */
+      bool poll(){
+        if(this->_count && this->_timeout_ms && absolute_time_diff_us(this->_first, Clock::now()) >= this->_timeout_ms * 1000ll){
+          return this->flush();
+        }
+        return false;
+      }
+
+      /**
+       * Publish any appended samples now. Returns true if a batch was published
+       * Handler only
+      */
+      bool flush(){
+        if(!this->_count){
+          return false;
+        }
+        this->compact<0>(*this->_buffer, Batch::stride(this->_count));
+        this->_buffer->length = Batch::stride(this->_count) * row;
+
+        Shared<Message> message = Postman::compose();
+        message->setProperty<uint32_t>(SAMPLES, this->_count);
+        message->attach(this->_buffer);
+        Postman::publish(message);
+
+        this->_buffer = nullptr;
+        this->_count = 0;
+        return true;
+      }
+
+      size_t size() const {
+        return this->_count;
+      }
+
+      /**
+       * Number of samples in a published batch
+      */
+      static size_t size(const Message &message){
+        return message.getProperty<uint32_t>(SAMPLES);
+      }
+
+      /**
+       * Values per column of a published batch of samples, rounded up to keep the columns 8 byte aligned
+      */
+      static constexpr size_t stride(const size_t samples){
+        return (samples + 7) & ~((size_t) 7);
+      }
+
+      /**
+       * Read only view of column I of a published batch
+      */
+      template<size_t I>
+      static Span<const Column<I>> column(const Message &message){
+        SharedConst<Buffer> buffer = message.buffer();
+        if(!buffer){
+          return Span<const Column<I>>();
+        }
+        size_t samples = Batch::size(message);
+        size_t offset = Batch::stride(samples) * Prefix<I, T...>::size;
+        if(samples > capacity || offset + samples * sizeof(Column<I>) > buffer->length){
+          return Span<const Column<I>>();
+        }
+        const uint8_t* data = buffer->view().data() + offset;
+        return Span<const Column<I>>(reinterpret_cast<const Column<I>*>(data), samples);
+      }
+
+    private:
+      Shared<Buffer> _buffer;
+      size_t _count = 0;
+      absolute_time_t _first = 0;
+      const uint32_t _timeout_ms;
+
+      template<size_t I>
+      void write(Buffer &buffer, const size_t index){}
+
+      /**
+       * Move columns from I on down to stride values apart, in order so no column overwrites one not yet moved
+      */
+      template<size_t I>
+      typename std::enable_if<(I == sizeof...(T))>::type compact(Buffer &buffer, const size_t stride){}
+
+      template<size_t I>
+      typename std::enable_if<(I < sizeof...(T))>::type compact(Buffer &buffer, const size_t stride){
+        uint8_t* from = buffer.data() + capacity * Prefix<I, T...>::size;
+        uint8_t* to = buffer.data() + stride * Prefix<I, T...>::size;
+        if(to != from){
+          memmove(to, from, this->_count * sizeof(Column<I>));
+        }
+        this->compact<I + 1>(buffer, stride);
+      }
+
+      template<size_t I, typename H, typename... R>
+      void write(Buffer &buffer, const size_t index, const H &value, const R&... rest){
+        Column<I>* column = reinterpret_cast<Column<I>*>(buffer.data() + capacity * Prefix<I, T...>::size);
+        column[index] = value;
+        this->write<I + 1>(buffer, index, rest...);
+      }
+  };
+
+  template<typename... T>
+  constexpr const char* Batch<T...>::SAMPLES;
+
+}
@@ -0,0 +1,198 @@
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+
+#include "Bridge.h"
+#include "Postman.h"
+#include "Supervisor.h"
+#include "Worker.h"
+#include "defs.h"
+
+
+namespace Postman {
+
+  Bridge::Bridge(const std::string &prefix, const Transport &transport) :
+    _prefix(prefix),
+    _transport(transport),
+    _encoder(Bridge::sink, this),
+    _decoder(Bridge::onField, Bridge::onFrame, this){}
+
+  Bridge::~Bridge(){
+    for(auto &proxy : this->_proxies){
+      Endpoint::release(proxy.endpoint);
+    }
+  }
+
+  bool Bridge::proxy(const std::string &uri, const uint8_t history){
+    Worker* self = Supervisor::self();
+    Weak<Endpoint> endpoint = Endpoint::create(this->_prefix + uri, self->endpoint, history);
+    if(Endpoint::isEmpty(endpoint)){
+      return false;
+    }
+
+    this->_control.clear();
+    this->_control.setProperty<std::string>("uri", uri);
+    if(!this->send(Op::SUBSCRIBE, this->_proxies.size(), this->_control)){
+      Endpoint::release(endpoint);
+      return false;
+    }
+    this->_proxies.push_back({ endpoint.lock() });
+    return true;
+  }
+
+  bool Bridge::poll(){
+    size_t length;
+
+    // Received frames are applied as they are decoded
+    while(this->_ok && (length = this->_transport.read(this->_input, BRIDGE_BUFFER_SIZE, this->_transport.context))){
+      if(!this->_decoder.feed(this->_input, length)){
+        this->_ok = false;
+      }
+    }
+
+    if(this->_owed){
+      this->_control.clear();
+      this->send(Op::CREDIT, this->_owed, this->_control);
+      this->_owed = 0;
+    }
+
+    for(uint32_t channel = 0; channel < this->_proxies.size() && this->_credits; channel++){
+      Shared<Endpoint> &endpoint = this->_proxies[channel].endpoint;
+      if(endpoint->hasSignals()){
+        uint8_t signals = endpoint->getSignals();
+        this->_control.clear();
+        this->_control.setProperty<uint32_t>("signals", signals);
+        if(!this->send(Op::NOTIFY, channel, this->_control)){
+          // Not sent, so give the consumed signals back for the next poll
+          while(signals-- && endpoint->signal());
+        }
+      }
+    }
+
+    for(uint32_t channel = 0; channel < this->_exports.size() && this->_credits; channel++){
+      Export &exported = this->_exports[channel];
+      Shared<Endpoint> endpoint = exported.endpoint.lock();
+      if(!endpoint && !exported.uri.empty()){  // Not open yet, or closed and reopened
+        endpoint = Endpoint::get(exported.uri);
+        exported.endpoint = endpoint;
+      }
+      // Pipeline every retained publish the peer hasn't seen while credit remains
+      while(endpoint && this->_credits && endpoint->peek(exported.since)){
+        bool overrun;
+        SharedConst<Message> message = endpoint->pull(exported.since, overrun);   // Advances since
+        if(!message){
+          break;
+        }
+        this->send(Op::PUBLISH, channel, *message, message->payload());
+      }
+    }
+
+    return this->flush();
+  }
+
+  void Bridge::run(){
+    while(this->poll()){
+      Postman::yield();
+    }
+  }
+
+  bool Bridge::send(const Op op, const uint32_t channel, const PropertySet &properties, const Span<const uint8_t> &payload){
+    bool credited = op == Op::PUBLISH || op == Op::NOTIFY;
+    if(!this->_ok || (credited && !this->_credits)){
+      return false;
+    }
+    if(!this->_encoder.encode((channel << 2) | op, properties, payload)){
+      this->_ok = false;
+      return false;
+    }
+    if(credited){
+      this->_credits--;
+    }
+    return true;
+  }
+
+  bool Bridge::sink(const uint8_t* data, size_t length, void* context){
+    Bridge* bridge = static_cast<Bridge*>(context);
+    while(length){
+      size_t count = std::min(length, (size_t) BRIDGE_BUFFER_SIZE - bridge->_length);
+      memcpy(bridge->_output + bridge->_length, data, count);
+      bridge->_length += count;
+      data += count;
+      length -= count;
+      if(bridge->_length == BRIDGE_BUFFER_SIZE && !bridge->flush()){
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool Bridge::flush(){
+    if(this->_ok && this->_length){
+      this->_ok = this->_transport.write(this->_output, this->_length, this->_transport.context);
+    }
+    this->_length = 0;
+    return this->_ok;
+  }
+
+  void Bridge::onField(const Wire::Field &field, void* context){
+    static_cast<Bridge*>(context)->field(field);
+  }
+
+  void Bridge::onFrame(uint32_t id, void* context){
+    static_cast<Bridge*>(context)->frame((Op) (id & 3), id >> 2);
+  }
+
+  /**
+   * Fields arrive before the frame's Op is acted on, so every field is collected into a new Message
+  */
+  void Bridge::field(const Wire::Field &field){
+    this->_collector.field(field);
+  }
+
+  void Bridge::frame(const Op op, const uint32_t channel){
+    Wire::Collected frame = this->_collector.take();
+    Shared<Message> &message = frame.message;
+
+    switch(op){
+      case Op::SUBSCRIBE:
+        if(message && message->hasProperty<std::string>("uri")){
+          if(channel >= this->_exports.size()){
+            this->_exports.resize(channel + 1);
+          }
+          Export &exported = this->_exports[channel];
+          exported.uri = message->getProperty<std::string>("uri");
+          exported.endpoint.reset();
+          exported.since = 0;
+        }
+        break;
+
+      case Op::PUBLISH:
+        this->_owed++;
+        if(channel < this->_proxies.size()){
+          Shared<Endpoint> &endpoint = this->_proxies[channel].endpoint;
+          endpoint->publish(frame.publishable(endpoint));
+        }
+        break;
+
+      case Op::NOTIFY:
+        this->_owed++;
+        if(channel < this->_exports.size()){
+          Export &exported = this->_exports[channel];
+          Shared<Endpoint> endpoint = exported.endpoint.lock();
+          if(!endpoint){
+            endpoint = Endpoint::get(exported.uri);
+          }
+          uint32_t signals = message ? message->getProperty<uint32_t>("signals") : 1;
+          while(endpoint && signals-- && endpoint->signal());
+        }
+        break;
+
+      case Op::CREDIT:
+        this->_credits = std::min(this->_credits + channel, (uint32_t) BRIDGE_CREDITS);
+        break;
+    }
+  }
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include <string>
+#include <vector>
+
+#include "Endpoint.h"
+#include "Message.h"
+#include "Wire.h"
+#include "defs.h"
+#include "pointers.h"
+
+namespace Postman {
+
+  /**
+   * Proxies Endpoints of a remote Postman over a reliable, ordered byte stream such as a UART or USB CDC.
+   * Each side runs a Bridge in a handler. A proxied remote URI appears locally as prefix + URI, an Endpoint
+   * caching the remote's latest publishes, so fetch() and get() are served locally without a round trip
+   * and notify() is forwarded to the remote Endpoint.
+   *
+   * Frames are Wire encoded, batched into BRIDGE_BUFFER_SIZE writes and pipelined without waiting for
+   * replies. Each side may have BRIDGE_CREDITS PUBLISH & NOTIFY frames in flight until its peer returns credit.
+   * Both Bridges must start on a quiet stream, there is no resynchronisation
+  */
+  class Bridge {
+
+    public:
+      struct Transport {
+        /**
+         * Read up to length bytes without blocking, returning the number read
+        */
+        size_t (*read)(uint8_t* data, size_t length, void* context);
+
+        /**
+         * Write length bytes, returns false on failure
+        */
+        bool (*write)(const uint8_t* data, size_t length, void* context);
+
+        void* context;
+      };
+
+      Bridge(const std::string &prefix, const Transport &transport);
+      ~Bridge();
+
+      /**
+       * Proxy remote uri as the local Endpoint prefix + uri, retaining history Messages. Returns success
+       * Handler only
+      */
+      bool proxy(const std::string &uri, const uint8_t history = 0);
+
+      /**
+       * Service the stream once: decode received frames, forward local notifies, send remote publishes
+       * while credit remains and flush. Returns false once the stream is corrupt
+       * Handler only. Will not block
+      */
+      bool poll();
+
+      /**
+       * poll() and yield() until the stream is corrupt
+       * Handler only
+      */
+      void run();
+
+    private:
+      enum Op : uint8_t {
+        SUBSCRIBE,    // fields: uri
+        PUBLISH,      // fields: Message properties & payload
+        NOTIFY,       // fields: signals
+        CREDIT,       // credit returned in place of the channel
+      };
+
+      /**
+       * Local stand-in for a remote Endpoint, the channel is its index
+      */
+      struct Proxy {
+        Shared<Endpoint> endpoint;
+      };
+
+      /**
+       * Local Endpoint subscribed to by the peer, the channel is its index
+      */
+      struct Export {
+        std::string uri;
+        Weak<Endpoint> endpoint;
+        uint32_t since = 0;
+      };
+
+      const std::string _prefix;
+      const Transport _transport;
+
+      std::vector<Proxy> _proxies;
+      std::vector<Export> _exports;
+
+      Wire::Encoder _encoder;
+      Wire::Decoder _decoder;
+
+      uint8_t _input[BRIDGE_BUFFER_SIZE];
+      uint8_t _output[BRIDGE_BUFFER_SIZE];
+      size_t _length = 0;
+      bool _ok = true;
+
+      uint8_t _credits = BRIDGE_CREDITS;   // Frames we may send
+      uint8_t _owed = 0;                   // Frames received but not yet credited
+
+      Wire::Collector _collector;   // Frame being decoded
+      PropertySet _control;
+
+      static bool sink(const uint8_t* data, size_t length, void* context);
+      static void onField(const Wire::Field &field, void* context);
+      static void onFrame(uint32_t id, void* context);
+
+      bool send(const Op op, const uint32_t channel, const PropertySet &properties, const Span<const uint8_t> &payload = Span<const uint8_t>());
+      bool flush();
+
+      void field(const Wire::Field &field);
+      void frame(const Op op, const uint32_t channel);
+  };
+
+}
@@ -0,0 +1,41 @@
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+
+#include "Buffer.h"
+#include "Memory.h"
+#include "Queue.h"
+#include "defs.h"
+
+namespace Postman {
+  INTERNAL_NS
+    Postman::Queue buffers("buffers");
+    uint8_t __attribute__((aligned(alignof(Buffer)))) bank[sizeof(Buffer) * BUFFER_POOL_SIZE];   // Placed statically, constructed by init()
+
+    void release(Buffer* buffer){
+      buffer->length = 0;
+      NS::buffers.push(buffer);
+    }
+  END_INTERNAL
+
+  void Buffer::init(){
+    NS::buffers.init();
+
+    Buffer* BufferPool = reinterpret_cast<Buffer*>(NS::bank);
+    for (int i = 0; i < BUFFER_POOL_SIZE; i++) {
+      NS::buffers.push(new (&BufferPool[i]) Buffer());
+    }
+  }
+
+  Shared<Buffer> Buffer::create(){
+    // No heap fall back, a burst of large Buffers would fragment the heap
+    Buffer* free = (Buffer*) NS::buffers.pop();
+    if(free){
+      return Shared<Buffer>(free, NS::release, Memory::Allocator<Buffer, Memory::BUFFERS>());
+    }
+    return nullptr;
+  }
+
+}
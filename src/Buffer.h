@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Node.h"
+#include "Span.h"
+#include "pointers.h"
+#include "defs.h"
+
+namespace Postman {
+
+  /**
+   * Fixed size binary payload allocated from a pre-allocated pool.
+   * Attached to a Message by reference so the payload is never copied
+  */
+  class Buffer : public Node {
+    public:
+      static void init();
+
+      /**
+       * Returns null if the pool is exhausted
+      */
+      static Shared<Buffer> create();
+
+      /**
+       * Number of bytes written to data()
+      */
+      size_t length = 0;
+
+      uint8_t* data(){
+        return this->_data;
+      }
+
+      size_t capacity() const {
+        return BUFFER_SIZE;
+      }
+
+      /**
+       * View of the written bytes as T
+      */
+      template<typename T = uint8_t>
+      Span<const T> view() const {
+        return Span<const T>(reinterpret_cast<const T*>(this->_data), this->length / sizeof(T));
+      }
+
+    private:
+      uint8_t __attribute__((aligned(8))) _data[BUFFER_SIZE];
+  };
+}
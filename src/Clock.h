@@ -0,0 +1,34 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include "pico/time.h"
+
+#include "Simulation.h"
+#include "defs.h"
+
+namespace Postman {
+namespace Clock {
+
+  /**
+   * Kernel time, the virtual clock when SIMULATION
+  */
+  __force_inline absolute_time_t now(){
+    return SIMULATION ? Simulation::now() : get_absolute_time();
+  }
+
+  __force_inline bool reached(const absolute_time_t time){
+    return absolute_time_diff_us(Clock::now(), time) <= 0;
+  }
+
+  __force_inline absolute_time_t after_us(const uint64_t duration_us){
+    return delayed_by_us(Clock::now(), duration_us);
+  }
+
+  __force_inline absolute_time_t after_ms(const uint32_t duration_ms){
+    return delayed_by_us(Clock::now(), duration_ms * 1000ull);
+  }
+
+}}
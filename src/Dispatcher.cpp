@@ -22,8 +22,11 @@
 
 #include "Dispatcher.h"
 #include "Supervisor.h"
+#include "Simulation.h"
+#include "Clock.h"
 #include "defs.h"
 #include "Worker.h"
+#include "Endpoint.h"
 
 
 extern "C" void __isr_SVCALL(void);
@@ -55,6 +58,8 @@ namespace Postman {
       // Install the exception handlers for Systick and SVC
       exception_set_exclusive_handler(SYSTICK_EXCEPTION, &__isr_SVCALL);
       exception_set_exclusive_handler(SVCALL_EXCEPTION, &__isr_SVCALL);
+      // PendSV preempts a Worker like Systick, so deferred interrupt requests are drained without waiting for the slice
+      exception_set_exclusive_handler(PENDSV_EXCEPTION, &__isr_SVCALL);
       // exception_set_exclusive_handler(HARDFAULT_EXCEPTION, fault_handler);
   }
 
@@ -97,50 +102,176 @@ namespace Postman {
       __dsb();                // make sure systick is disabled
       __isb();                // and it is really off
 
-      // clear the systick pending bit if it got set
-      hw_set_bits((io_rw_32*)(PPB_BASE + M0PLUS_ICSR_OFFSET),M0PLUS_ICSR_PENDSTCLR_BITS);
+      // clear the systick and pendsv pending bits if they got set
+      hw_set_bits((io_rw_32*)(PPB_BASE + M0PLUS_ICSR_OFFSET),M0PLUS_ICSR_PENDSTCLR_BITS | M0PLUS_ICSR_PENDSVCLR_BITS);
       
       idle_time = DISPATCHER_MAX_IDLE_TIME;
+
+      // Runnable Workers & the earliest timeout this pass, for the fast path
+      uint32_t epoch = Supervisor::epoch();
+      Worker* only = nullptr;
+      uint8_t runnable = 0;
+      absolute_time_t wake = 0;
       
-      while((worker = Supervisor::next())){
+      while(1){
+        if(SIMULATION){
+          Simulation::begin();    // Each step of the pass waits for this core's turn
+        }
+        if(!(worker = Supervisor::next())){
+          break;
+        }
+        bool dispatched = false;
+        this->drain();
+
+        if(DISPATCHER_EDF){
+          // Released periodic jobs run ahead of the round robin once each, earliest deadline first
+          Worker* periodic;
+          while((periodic = Supervisor::earliest())){
+            this->dispatch(periodic);
+            only = periodic;
+            runnable++;
+            periodic->release();
+            this->drain();
+            dispatched = true;
+          }
+        }
+
         if(worker->bind()){      // Try to bind the worker to the current core
           if(!worker->isSleeping() && !worker->isBlocking()){
             this->dispatch(worker);
             // Worker suspended here
-            if(worker->isZombie()){
-              printf("Found zombie: %s\n", worker->endpoint->uri.c_str());
-              Supervisor::halt(worker);
-            }
+            dispatched = true;
+            only = worker;
+            runnable++;
           }
 
           if(worker->timeout > 0){
-            worker_timeout = absolute_time_diff_us(get_absolute_time(), worker->timeout);
+            worker_timeout = absolute_time_diff_us(Clock::now(), worker->timeout);
             if(worker_timeout < idle_time){
               idle_time = worker_timeout;
             }
+            if(!wake || absolute_time_diff_us(worker->timeout, wake) > 0){
+              wake = worker->timeout;
+            }
           }
 
           worker->release();    // Release the worker from current dispatcher
         }
+
+        if(SIMULATION){
+          Simulation::end(dispatched);
+        }
       }
-      if(idle_time > 0){
-        sleep_us(idle_time);
+
+      if(DISPATCHER_FAST_YIELD){
+        this->_alone = runnable == 1 ? only : nullptr;
+        this->_aloneEpoch = epoch;
+        this->_aloneUntil = wake ? wake : Clock::after_us(DISPATCHER_MAX_IDLE_TIME);
       }
+      if(SIMULATION){
+        Simulation::idle(idle_time);    // Virtual time jumps rather than idling
+      }
+      else if(idle_time > 0){
+        absolute_time_t start = Clock::now();
+        absolute_time_t idle_until = delayed_by_us(start, idle_time);
+        while(this->_deferredHead == this->_deferredTail && !time_reached(idle_until)){
+          tight_loop_contents();    // Stop idling early if an interrupt defers work
+        }
+        this->idle += absolute_time_diff_us(start, Clock::now());
+      }
+      this->passes++;
     }
 
   }
 
   void Dispatcher::dispatch(Worker* worker){
     // NOTE: setting Time Slice to 0 will disable Systick and turn off preemptive scheduling!
-    systick_hw->rvr = WORKER_TIME_SLICE; // set for interval
+    systick_hw->rvr = worker->quantum(); // set for interval
     systick_hw->cvr = 0;    // reset the current counter
     __dsb();                // make sure systick is set
     __isb();                // and it is really ready
-    systick_hw->csr = 3;    // Enable systick timer and IRQ, select 1 usec clock
+    systick_hw->csr = SIMULATION ? 0 : 3;   // Enable systick timer and IRQ, select 1 usec clock. Simulated Workers must yield
 
+    absolute_time_t start = Clock::now();
     this->_worker = worker;
+    worker->pending = false;    // However it was picked, the released job has now been dispatched
     worker->run();
     this->_worker = 0;
+    // Virtual time stands still while a simulated Worker runs, each dispatch costs a fixed step instead
+    uint64_t elapsed = SIMULATION ? SIMULATION_DISPATCH_COST : absolute_time_diff_us(start, Clock::now());
+    this->busy += elapsed;
+    worker->endpoint->cpu += elapsed;
+
+    // Stop the slice so it can't expire during the rest of the pass, COUNTFLAG is set if it expired
+    bool preempted = systick_hw->csr & M0PLUS_SYST_CSR_COUNTFLAG_BITS;
+    systick_hw->csr = 0;
+    hw_set_bits((io_rw_32*)(PPB_BASE + M0PLUS_ICSR_OFFSET), M0PLUS_ICSR_PENDSTCLR_BITS);
+    worker->account(preempted);
+
+    if(worker->isZombie()){
+      printf("Found zombie: %s\n", worker->endpoint->uri.c_str());
+      Supervisor::halt(worker);
+    }
+  }
+
+  bool Dispatcher::alone(const absolute_time_t until){
+    if(!this->_alone || this->_alone != this->_worker || this->_aloneEpoch != Supervisor::epoch()){
+      return false;
+    }
+    if(this->_deferredHead != this->_deferredTail || absolute_time_diff_us(until, this->_aloneUntil) <= 0){
+      return false;
+    }
+    // The Systick counts down the rest of the slice in us
+    return absolute_time_diff_us(Clock::now(), until) < (int64_t) systick_hw->cvr;
+  }
+
+  bool Dispatcher::defer(const Shared<Endpoint> &target, const bool publish, const uint32_t value){
+    bool deferred = false;
+
+    // Nested interrupts on this core may also defer, the other core has its own queue
+    int interrupts = save_and_disable_interrupts();
+      uint8_t head = this->_deferredHead;
+      uint8_t next = (head + 1) % DISPATCHER_DEFERRED_SIZE;
+      if(next != this->_deferredTail){
+        this->_deferred[head].key = target->key;
+        this->_deferred[head].target = target.get();
+        this->_deferred[head].value = value;
+        this->_deferred[head].publish = publish;
+        __dmb();
+        this->_deferredHead = next;
+        deferred = true;
+      }
+    restore_interrupts(interrupts);
+
+    if(deferred){
+      Supervisor::wake();
+      // Preempt the running Worker so the Dispatcher drains before the next dispatch
+      hw_set_bits((io_rw_32*)(PPB_BASE + M0PLUS_ICSR_OFFSET), M0PLUS_ICSR_PENDSVSET_BITS);
+    }
+    return deferred;
+  }
+
+  void Dispatcher::drain(){
+    // Clear the pended preemption first, anything deferred from here on pends it again
+    hw_set_bits((io_rw_32*)(PPB_BASE + M0PLUS_ICSR_OFFSET), M0PLUS_ICSR_PENDSVCLR_BITS);
+
+    /**
+     * Runs in handler mode, so nothing here allocates or publishes. A value is handed to the target,
+     * whose own Worker publishes it, keeping publish() single writer. The target may have been
+     * released since it was deferred, so it is looked up again in the registry
+    */
+    while(this->_deferredTail != this->_deferredHead){
+      Deferred &deferred = this->_deferred[this->_deferredTail];
+      Shared<Endpoint> target = Endpoint::get(deferred.key, deferred.target);
+      if(target){
+        if(deferred.publish){
+          target->pend(deferred.value);
+        }
+        target->signal();
+      }
+      __dmb();
+      this->_deferredTail = (this->_deferredTail + 1) % DISPATCHER_DEFERRED_SIZE;
+    }
   }
 
-}
\ No newline at end of file
+}
@@ -2,10 +2,14 @@
 
 #include "pico/stdlib.h"
 
+#include "defs.h"
+#include "pointers.h"
+
 namespace Postman { 
 
   // Forward declare
   class Worker;
+  class Endpoint;
 
   class Dispatcher {
 
@@ -15,12 +19,61 @@ namespace Postman {
       static void init();
 
       const uint8_t core;
+
+      /**
+       * Total time spent running Workers, and idling, in us of Clock time
+      */
+      volatile uint64_t busy = 0;
+      volatile uint64_t idle = 0;
+
+      /**
+       * Number of scheduling passes over the ready Workers
+      */
+      volatile uint32_t passes = 0;
+
       Worker* worker();
       void begin();
 
+      /**
+       * Queue a signal, or a value for target to publish, from an interrupt on this core.
+       * Interrupt safe. Returns false if the deferred queue is full
+      */
+      bool defer(const Shared<Endpoint> &target, const bool publish, const uint32_t value = 0);
+
+      /**
+       * Whether the running Worker was the only runnable one in the last pass, and nothing since,
+       * neither a wake() nor a timeout before until, could make another runnable within its slice.
+       * Call with interrupts disabled, see Supervisor::alone()
+      */
+      bool alone(const absolute_time_t until);
+
     private:
       __force_inline void dispatch(Worker* worker);
+      void drain();
       Worker* _worker;
+
+      // Fast path state of the last pass, see alone()
+      Worker* _alone = nullptr;
+      uint32_t _aloneEpoch = 0;
+      absolute_time_t _aloneUntil = 0;
+
+      /**
+       * The target is held by its registry key and address rather than a reference, as counting a
+       * reference from an interrupt would race the other core. Resolved in drain()
+      */
+      struct Deferred {
+        uint32_t key;
+        const Endpoint* target;
+        uint32_t value;
+        bool publish;
+      };
+
+      /**
+       * Single producer (interrupts on this core), single consumer (this Dispatcher) ring
+      */
+      Deferred _deferred[DISPATCHER_DEFERRED_SIZE];
+      volatile uint8_t _deferredHead = 0;
+      volatile uint8_t _deferredTail = 0;
       
   };
 
@@ -5,55 +5,390 @@
 
 
 #include "pico/multicore.h"
+#include "hardware/sync.h"
 
 #include "Endpoint.h"
+#include "Clock.h"
+#include "Lock.h"
+#include "Memory.h"
+#include "Supervisor.h"
+#include "Trace.h"
 #include "defs.h"
 
 
-#include <map>
 
 namespace Postman {
 
   INTERNAL_NS
-    std::map<std::string, Shared<Endpoint>> endpoints;
-    critical_section_t crit_sec;
+
+    enum SlotState : uint8_t {
+      EMPTY,        // Never used, ends a probe
+      LIVE,
+      TOMBSTONE,    // Released, probes continue past it
+    };
+
+    struct Slot {
+      Shared<Endpoint> endpoint;
+      volatile uint32_t key = 0;
+      volatile uint8_t state = SlotState::EMPTY;
+    };
+
+    /**
+     * Open addressing hash table of Endpoints, linear probing.
+     * Writers serialise on the registry Lock, readers never lock or allocate. A reader flags the slot
+     * it is dereferencing per core so release() never resets a slot mid-read.
+    */
+    Slot registry[ENDPOINT_REGISTRY_SIZE];
+    volatile uint8_t hazard[2] = {0, 0};
+
+    static_assert((ENDPOINT_REGISTRY_SIZE & (ENDPOINT_REGISTRY_SIZE - 1)) == 0, "ENDPOINT_REGISTRY_SIZE must be a power of 2");
+    Postman::Lock lock("registry");
+    Postman::Lock pending("pending");   // Endpoint pend() & deliver()
+    Postman::Lock history("history");   // Endpoint publication rings, see copy()
+
+    /**
+     * URI path segment trie for pattern matching, also guarded by the registry Lock.
+     * Endpoints are removed from the trie before they are released, so raw pointers stay valid under the Lock.
+     * Nothing under the Lock allocates or frees: URIs are split into a Path, and new nodes are built before
+     * it is taken, then only linked in. Removed nodes are unlinked into a reserved vector & freed after it is released.
+     * Children are an intrusive sibling list, so linking & unlinking a node never allocates
+    */
+    struct Segment : Memory::Allocated<Memory::ENDPOINTS> {
+      std::string name;
+      Endpoint* endpoint = nullptr;
+      Unique<Segment> child;      // First child
+      Unique<Segment> sibling;    // Next child of the same parent
+    };
+
+    typedef std::vector<Unique<Segment>> Nodes;
+    typedef std::vector<std::string> Path;
+
+    Segment tree;
+
+    /**
+     * Read the next path segment of uri from pos into name, advancing pos past it
+    */
+    bool segment(const std::string &uri, size_t &pos, std::string &name){
+      while(pos < uri.size() && uri[pos] == '/'){
+        pos++;
+      }
+      if(pos >= uri.size()){
+        return false;
+      }
+      size_t end = uri.find('/', pos);
+      if(end == std::string::npos){
+        end = uri.size();
+      }
+      name.assign(uri, pos, end - pos);
+      pos = end;
+      return true;
+    }
+
+    void split(const std::string &uri, Path &path){
+      std::string name;
+      size_t pos = 0;
+      while(NS::segment(uri, pos, name)){
+        path.push_back(name);
+      }
+    }
+
+    /**
+     * Whether uri is "/" separated non empty segments, so distinct URIs never share a trie node
+    */
+    bool valid(const std::string &uri){
+      return uri.size() > 1 && uri.front() == '/' && uri.back() != '/' && uri.find("//") == std::string::npos;
+    }
+
+    Segment* child(Segment &node, const std::string &name){
+      for(Segment* child = node.child.get(); child; child = child->sibling.get()){
+        if(child->name == name){
+          return child;
+        }
+      }
+      return nullptr;
+    }
+
+    /**
+     * A detached node for each segment of uri, for insert()
+    */
+    void build(const std::string &uri, Nodes &nodes){
+      std::string name;
+      size_t pos = 0;
+      while(NS::segment(uri, pos, name)){
+        nodes.push_back(Unique<Segment>(new Segment()));
+        nodes.back()->name = name;
+      }
+    }
+
+    /**
+     * Link endpoint into the trie, linking in the built nodes of missing segments. Unused nodes are left for the caller to free
+    */
+    void insert(Endpoint* endpoint, Nodes &nodes){
+      Segment* node = &NS::tree;
+      for(Unique<Segment> &built : nodes){
+        Segment* next = NS::child(*node, built->name);
+        if(!next){
+          next = built.get();
+          built->sibling = std::move(node->child);
+          node->child = std::move(built);
+        }
+        node = next;
+      }
+      node->endpoint = endpoint;
+    }
+
+    /**
+     * Remove path below node from depth, unlinking pruned nodes into removed, which must have room for
+     * one per segment. Returns true if node is left empty and can be pruned
+    */
+    bool remove(Segment &node, const Path &path, const size_t depth, Nodes &removed){
+      if(depth == path.size()){
+        node.endpoint = nullptr;
+      }
+      else {
+        for(Unique<Segment>* link = &node.child; *link; link = &(*link)->sibling){
+          if((*link)->name == path[depth]){
+            if(NS::remove(**link, path, depth + 1, removed)){
+              removed.push_back(std::move(*link));
+              *link = std::move(removed.back()->sibling);
+            }
+            break;
+          }
+        }
+      }
+      return !node.endpoint && !node.child;
+    }
+
+    uint16_t subtree(Segment &node, const Endpoint::Visitor &visitor, void* data){
+      uint16_t count = 0;
+      if(node.endpoint){
+        visitor(*node.endpoint, data);
+        count++;
+      }
+      for(Segment* child = node.child.get(); child; child = child->sibling.get()){
+        count += NS::subtree(*child, visitor, data);
+      }
+      return count;
+    }
+
+    uint16_t match(Segment &node, const Path &pattern, const size_t depth, const Endpoint::Visitor &visitor, void* data){
+      uint16_t count = 0;
+
+      if(depth == pattern.size()){   // End of pattern
+        if(node.endpoint){
+          visitor(*node.endpoint, data);
+          count++;
+        }
+      }
+      else if(pattern[depth] == "**"){
+        count = NS::subtree(node, visitor, data);
+      }
+      else if(pattern[depth] == "*"){
+        for(Segment* child = node.child.get(); child; child = child->sibling.get()){
+          count += NS::match(*child, pattern, depth + 1, visitor, data);
+        }
+      }
+      else {
+        Segment* child = NS::child(node, pattern[depth]);
+        if(child){
+          count = NS::match(*child, pattern, depth + 1, visitor, data);
+        }
+      }
+      return count;
+    }
 
     const uint8_t MAX_SIGNALS = 255;
+
+    /**
+     * Walk the probe chain for key, under the registry Lock. Returns false if uri is already registered,
+     * otherwise sets free to the first reusable slot in the chain, or -1 if the registry is full
+    */
+    bool probe(const uint32_t key, const std::string &uri, int16_t &free){
+      free = -1;
+      for(uint8_t i = 0; i < ENDPOINT_REGISTRY_SIZE; i++){
+        uint8_t slot = (key + i) & (ENDPOINT_REGISTRY_SIZE - 1);
+        Slot &entry = NS::registry[slot];
+
+        if(entry.state == SlotState::LIVE){
+          if(entry.key == key && entry.endpoint->uri == uri){   // Duplicate
+            return false;
+          }
+          continue;
+        }
+        if(free < 0){
+          free = slot;
+        }
+        if(entry.state == SlotState::EMPTY){
+          break;
+        }
+      }
+      return true;
+    }
+
+    /**
+     * Endpoint in slot if it is live with key, and uri unless null, and is same unless null
+    */
+    Shared<Endpoint> read(const uint8_t slot, const uint32_t key, const char* uri, const Endpoint* same = nullptr){
+      Shared<Endpoint> endpoint;
+
+      // Interrupts off so the Worker can't be preempted or moved to the other core, one hazard per core
+      int interrupts = save_and_disable_interrupts();
+        uint8_t core = get_core_num();
+        NS::hazard[core] = slot + 1;
+        __dmb();
+        Slot &entry = NS::registry[slot];
+        if(entry.state == SlotState::LIVE && entry.key == key && (!uri || entry.endpoint->uri == uri) &&
+          (!same || entry.endpoint.get() == same)){
+          endpoint = entry.endpoint;
+        }
+        __dmb();
+        NS::hazard[core] = 0;
+      restore_interrupts(interrupts);
+
+      return endpoint;
+    }
+
+    Shared<Endpoint> find(const uint32_t key, const char* uri, const Endpoint* same = nullptr){
+      for(uint8_t i = 0; i < ENDPOINT_REGISTRY_SIZE; i++){
+        uint8_t slot = (key + i) & (ENDPOINT_REGISTRY_SIZE - 1);
+        uint8_t state = NS::registry[slot].state;
+
+        if(state == SlotState::EMPTY){
+          break;
+        }
+        if(state == SlotState::LIVE && NS::registry[slot].key == key){
+          Shared<Endpoint> endpoint = NS::read(slot, key, uri, same);
+          if(endpoint){
+            return endpoint;
+          }
+        }
+      }
+      return nullptr;
+    }
+
   END_INTERNAL
 
   const Weak<Endpoint> Endpoint::Empty = Weak<Endpoint>();
 
   // BEGIN STATIC
   void Endpoint::init(){
-    critical_section_init(&NS::crit_sec);
+    NS::lock.init();
+    NS::pending.init();
+    NS::history.init();
   }
 
-  Weak<Endpoint> Endpoint::create(const std::string &uri, Weak<Endpoint> owner) {
-    auto endpoints = NS::endpoints.find(uri);
-    if (endpoints != NS::endpoints.end()) {
+  Weak<Endpoint> Endpoint::create(const std::string &uri, Weak<Endpoint> owner, const uint8_t history, const uint32_t quantum,
+    const Shared<WorkQueue> &queue) {
+    const uint32_t key = Endpoint::hash(uri.c_str());
+    int16_t free;
+
+    if(!NS::valid(uri)){
       return Endpoint::Empty;
     }
-    else {
-      Shared<Endpoint> Ep = Shared<Endpoint>(new Endpoint(uri, owner));
-      NS::endpoints.emplace(uri, Ep);
-      Weak<Endpoint> endpoint = Ep;
-      return endpoint;
+
+    NS::lock.lock();
+    bool unique = NS::probe(key, uri, free);
+    NS::lock.unlock();
+
+    if(!unique || free < 0){
+      return Endpoint::Empty;
     }
+
+    // Construct outside the Lock, it allocates
+    Shared<Endpoint> endpoint = Shared<Endpoint>(new Endpoint(uri, owner, history, quantum, queue),
+      std::default_delete<Endpoint>(), Memory::Allocator<Endpoint, Memory::ENDPOINTS>());
+    NS::Nodes nodes;
+    NS::build(uri, nodes);
+
+    // Walk the probe chain again, a concurrent create() or release() may have changed it since
+    NS::lock.lock();
+    bool claimed = NS::probe(key, uri, free) && free >= 0;
+    if(claimed){
+      NS::Slot &entry = NS::registry[free];
+      entry.endpoint = endpoint;
+      entry.key = key;
+      __dmb();
+      entry.state = NS::SlotState::LIVE;
+      NS::insert(endpoint.get(), nodes);
+    }
+    NS::lock.unlock();
+
+    if(!claimed){
+      return Endpoint::Empty;   // endpoint & nodes are destroyed outside the Lock
+    }
+    if(TRACE){
+      Trace::created(*endpoint);
+    }
+    return endpoint;
   }
 
   void Endpoint::release(Weak<Endpoint> target){
     Shared<Endpoint> endpoint = target.lock();
-    if(endpoint){
-      NS::endpoints.erase(endpoint->uri);
+    if(!endpoint){
+      return;
     }
+
+    Shared<Endpoint> released;
+    NS::Path path;
+    NS::split(endpoint->uri, path);
+    NS::Nodes removed;
+    removed.reserve(path.size());
+
+    NS::lock.lock();
+    for(uint8_t i = 0; i < ENDPOINT_REGISTRY_SIZE; i++){
+      NS::Slot &entry = NS::registry[(endpoint->key + i) & (ENDPOINT_REGISTRY_SIZE - 1)];
+      if(entry.state == NS::SlotState::EMPTY){
+        break;
+      }
+      if(entry.state == NS::SlotState::LIVE && entry.endpoint == endpoint){
+        uint8_t slot = &entry - NS::registry;
+        entry.state = NS::SlotState::TOMBSTONE;
+        __dmb();
+        while(NS::hazard[0] == slot + 1 || NS::hazard[1] == slot + 1){
+          tight_loop_contents();
+        }
+        released.swap(entry.endpoint);
+        NS::remove(NS::tree, path, 0, removed);
+        break;
+      }
+    }
+    NS::lock.unlock();
+    Supervisor::wake();   // Workers blocked on it now fail
+    // released & removed are destroyed outside the Lock
   }
 
   Shared<Endpoint> Endpoint::get(const std::string &uri) {
-    auto endpoints = NS::endpoints.find(uri);
-    if (endpoints != NS::endpoints.end()) {
-      return endpoints->second;
-    }
-    return nullptr;
+    return NS::find(Endpoint::hash(uri.c_str()), uri.c_str());
+  }
+
+  Shared<Endpoint> Endpoint::get(const uint32_t key, const char* uri) {
+    return NS::find(key, uri);
+  }
+
+  Shared<Endpoint> Endpoint::get(const uint32_t key, const Endpoint* endpoint) {
+    return NS::find(key, nullptr, endpoint);
+  }
+
+  uint16_t Endpoint::each(const std::string &pattern, const Visitor &visitor, void* data){
+    NS::Path path;
+    NS::split(pattern, path);
+
+    NS::lock.lock();
+    uint16_t count = NS::match(NS::tree, path, 0, visitor, data);
+    NS::lock.unlock();
+    return count;
+  }
+
+  uint16_t Endpoint::match(const std::string &pattern, std::vector<Shared<Endpoint>> &endpoints){
+    // Room for every registered Endpoint up front, so the visitor never grows the vector under the Lock
+    endpoints.reserve(endpoints.size() + ENDPOINT_REGISTRY_SIZE);
+    auto visitor = [](Endpoint &endpoint, void* data){
+      std::vector<Shared<Endpoint>>* endpoints = static_cast<std::vector<Shared<Endpoint>>*>(data);
+      if(endpoints->size() < endpoints->capacity()){
+        endpoints->push_back(endpoint.shared_from_this());
+      }
+    };
+    return Endpoint::each(pattern, visitor, &endpoints);
   }
 
   bool Endpoint::isEmpty(std::weak_ptr<Endpoint> const &endpoint) {
@@ -62,8 +397,25 @@ namespace Postman {
 
   // END STATIC
 
-  Endpoint::Endpoint(const std::string &uri, const Weak<Endpoint> owner) : uri(uri), owner(owner){
+  Endpoint::Endpoint(const std::string &uri, const Weak<Endpoint> owner, const uint8_t history, const uint32_t quantum,
+    const Shared<WorkQueue> &queue) :
+    uri(uri), key(Endpoint::hash(uri.c_str())), owner(owner),
+    quantum(quantum > Endpoint::MAX_QUANTUM ? Endpoint::MAX_QUANTUM : quantum), queue(queue),
+    _capacity((history > ENDPOINT_MAX_HISTORY ? ENDPOINT_MAX_HISTORY : (history ? history : 1)) + 1),
+    _public(new Shared<Message>[_capacity]){
     sem_init(&this->_signals, NS::MAX_SIGNALS, NS::MAX_SIGNALS);
+    Memory::account(Memory::ENDPOINTS, this->footprint());
+  }
+
+  Endpoint::~Endpoint(){
+    Memory::account(Memory::ENDPOINTS, -this->footprint());
+  }
+
+  int32_t Endpoint::footprint() const {
+    // A short URI is stored inside the std::string itself, only a longer one has heap storage
+    const char* data = this->uri.data();
+    bool heap = data < (const char*) &this->uri || data >= (const char*) (&this->uri + 1);
+    return sizeof(Endpoint) + (heap ? this->uri.capacity() + 1 : 0) + this->_capacity * sizeof(Shared<Message>);
   }
 
   const char* Endpoint::toString(){
@@ -82,32 +434,150 @@ namespace Postman {
     uint8_t signals = NS::MAX_SIGNALS - sem_available(&this->_signals);
     if(signals > 0){
       sem_reset(&this->_signals, NS::MAX_SIGNALS);
+      Supervisor::wake();   // Notifiers blocked on a full semaphore may now signal
     }
     return signals;
   }
 
   bool Endpoint::signal(){
     if(sem_try_acquire(&this->_signals)){
+      Supervisor::wake();
+      if(TRACE){
+        Trace::signalled(*this);
+      }
       return true;
     }
     return false;
   }
 
   void Endpoint::publish(Shared<Message> message){
-    critical_section_enter_blocking(&NS::crit_sec);
-    this->_public = message;
-    critical_section_exit(&NS::crit_sec);
+    /**
+     * Only the Endpoint's own Worker publishes, so there is a single writer.
+     * Write into the idle slot and advance the sequence together under the history Lock,
+     * so no reader copies the slot mid-write.
+    */
+    uint32_t sequence = this->_sequence + 1;
+    uint8_t idle = sequence % this->_capacity;
+
+    if(TRACE && message){
+      message->published = to_us_since_boot(Clock::now());
+      Trace::published(*this, *message);
+    }
+
+    // Swapping moves the pointers without touching a reference count
+    NS::history.lock();
+      this->_public[idle].swap(message);
+      this->_sequence = sequence;
+    NS::history.unlock();
+    // message is now the overwritten Message, released here outside the Lock
+    Supervisor::wake();
+    __dmb();
   }
 
-  bool Endpoint::peek(uint32_t postid){
-    if(this->_public && this->_public->id > postid){
-      return true;
+  bool Endpoint::pend(const uint32_t value){
+    bool pended = false;
+    NS::pending.lock();
+      if(this->_pendingCount < ENDPOINT_PENDING_SIZE){
+        this->_pendingValues[(this->_pendingHead + this->_pendingCount) % ENDPOINT_PENDING_SIZE] = value;
+        this->_pendingCount++;
+        pended = true;
+      }
+      else {
+        this->pendingDropped++;
+      }
+    NS::pending.unlock();
+    return pended;
+  }
+
+  bool Endpoint::deliver(){
+    if(!this->_pendingCount){
+      return false;
     }
-    return false;
+    // Values pended while publishing are delivered by the same call
+    while(this->_pendingCount){
+      NS::pending.lock();
+        uint32_t value = this->_pendingValues[this->_pendingHead];
+        this->_pendingHead = (this->_pendingHead + 1) % ENDPOINT_PENDING_SIZE;
+        this->_pendingCount--;
+      NS::pending.unlock();
+
+      Shared<Message> message = Message::create(this->shared_from_this());
+      message->setProperty("value", value);
+      this->publish(message);
+    }
+    return true;
+  }
+
+  bool Endpoint::peek(uint32_t since){
+    return this->_sequence > since;
+  }
+
+  bool Endpoint::copy(const uint32_t sequence, const uint8_t slot, SharedConst<Message> &message){
+    bool copied = false;
+    /**
+     * Copying a Shared increments its count, which the M0+ can't do atomically, so the copy is
+     * made under the history Lock against a reader or publish() on the other core.
+     * If publish() moved on since sequence was read, the slot may have been overwritten so retry.
+    */
+    NS::history.lock();
+      if(sequence == this->_sequence){
+        message = this->_public[slot];
+        copied = true;
+      }
+    NS::history.unlock();
+    return copied;
   }
 
   SharedConst<Message> Endpoint::pull(){
-    return this->_public;
+    uint32_t since = 0;
+    bool overrun;
+    return this->pull(since, overrun);
+  }
+
+  SharedConst<Message> Endpoint::pull(uint32_t &since, bool &overrun){
+    SharedConst<Message> message;
+    uint32_t sequence;
+    uint32_t next;
+
+    /**
+     * Slots are found from the sequence alone, so nothing the writer updates is read outside the Lock.
+     * copy() re-checks the sequence, so the slot is still the one wanted once locked
+    */
+    do {
+      sequence = this->_sequence;
+      __dmb();
+      overrun = false;
+
+      if(sequence == 0 || (since && since >= sequence)){
+        return nullptr;
+      }
+      next = sequence;    // Live
+      if(since){
+        uint32_t retained = this->_capacity - 1;
+        uint32_t oldest = sequence > retained ? sequence - retained + 1 : 1;
+        next = since + 1;
+        if(next < oldest){
+          overrun = true;
+          next = oldest;
+        }
+      }
+    } while(!this->copy(sequence, next % this->_capacity, message));
+
+    since = next;
+    return message;
+  }
+
+  bool Endpoint::pull(uint32_t &since, std::vector<SharedConst<Message>> &messages){
+    bool overrun;
+    bool lossless = true;
+    SharedConst<Message> message = this->pull(since, overrun);
+
+    while(message){
+      lossless = lossless && !overrun;
+      messages.push_back(message);
+      message = this->pull(since, overrun);
+    }
+    return lossless;
   }
 
 }
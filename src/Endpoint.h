@@ -3,50 +3,196 @@
 #include "pico/sem.h"
 
 #include <string>
+#include <vector>
 #include "Message.h"
 
 namespace Postman {
+
+  // Forward declare
+  class WorkQueue;
   
-  class Endpoint {
+  class Endpoint : public std::enable_shared_from_this<Endpoint> {
     
     public:
       typedef void (*Handler)();
+      typedef void (*Visitor)(Endpoint &endpoint, void* data);
       const static Weak<Endpoint> Empty;
 
+      /**
+       * Endpoint of a static topology, see Postman::start(). Tables are constexpr, so each key is
+       * computed at compile time and can be resolved with Postman::handle() without building a string
+      */
+      struct Declaration {
+        const char* uri;
+        Handler handler;
+        uint8_t history;
+        uint32_t quantum;   // us
+        uint32_t key;       // hash(uri)
+
+        constexpr Declaration(const char* uri, const Handler handler, const uint8_t history = 0, const uint32_t quantum = 0) :
+          uri(uri), handler(handler), history(history), quantum(quantum), key(Endpoint::hash(uri)){}
+      };
+
       static void init();
       
-      static Weak<Endpoint> create(const std::string &uri, Weak<Endpoint> owner);
+      /**
+       * Register a new Endpoint. A URI is "/" separated non empty segments such as "/a/b", so "/a/b/" & "/a//b"
+       * are rejected. Returns Empty for an invalid or duplicate uri, or if the registry is full
+      */
+      static Weak<Endpoint> create(const std::string &uri, Weak<Endpoint> owner, const uint8_t history = 0, const uint32_t quantum = 0,
+        const Shared<WorkQueue> &queue = nullptr);
       static void release(Weak<Endpoint> endpoint);
 
       static Shared<Endpoint> get(const std::string &uri);
+
+      /**
+       * Endpoint by its precomputed key, hash(uri). uri is still compared, as a key may collide
+      */
+      static Shared<Endpoint> get(const uint32_t key, const char* uri);
+
+      /**
+       * endpoint by its key if it is still registered. endpoint is only compared, never dereferenced,
+       * so it may already have been released
+      */
+      static Shared<Endpoint> get(const uint32_t key, const Endpoint* endpoint);
       static bool isEmpty(std::weak_ptr<Endpoint> const &endpoint);
 
+      /**
+       * Visit every Endpoint whose URI matches pattern, returning the number visited.
+       * A "*" segment matches any one segment, a trailing "**" matches the whole subtree.
+       * Cost is proportional to the pattern depth plus the wildcard fan out.
+       * Visitors are called under the registry Lock so must be short and must not create or release Endpoints
+      */
+      static uint16_t each(const std::string &pattern, const Visitor &visitor, void* data = nullptr);
+      static uint16_t match(const std::string &pattern, std::vector<Shared<Endpoint>> &endpoints);
+
+      /**
+       * FNV-1a hash of a URI, usable at compile time
+      */
+      static constexpr uint32_t hash(const char* uri, const uint32_t hash = 2166136261u){
+        return *uri ? Endpoint::hash(uri + 1, (hash ^ (uint8_t) *uri) * 16777619u) : hash;
+      }
+
       const std::string uri;
+      const uint32_t key;     // hash(uri)
       const Weak<Endpoint> owner;
 
+      /**
+       * Initial time slice of the Endpoint's Worker in us, 0 for WORKER_TIME_SLICE.
+       * Clamped to MAX_QUANTUM, the largest SysTick reload
+      */
+      const uint32_t quantum;
+      static constexpr uint32_t MAX_QUANTUM = 0xFFFFFF;
+
       /**
        * Arbitrary data used by Endpoint during callbacks
       */
       void* data;
 
+      /**
+       * Number of periodic releases completed after their deadline
+      */
+      volatile uint32_t deadlineMisses = 0;
+
+      /**
+       * Number of times the Endpoint's Worker was preempted at the end of its time slice
+      */
+      volatile uint32_t preemptions = 0;
+
+      /**
+       * Total time the Endpoint's Worker has run in us
+      */
+      volatile uint64_t cpu = 0;
+
+      /**
+       * Number & total bytes of accounted allocations made by the Endpoint's handler, while MEMORY_ACCOUNTING
+      */
+      volatile uint32_t allocations = 0;
+      volatile uint32_t allocated = 0;
+
+      /**
+       * Work queue of the consumer group the Endpoint fronts or belongs to, null for other Endpoints.
+       * Set at create(), so it is in place before the Endpoint can be found
+      */
+      const Shared<WorkQueue> queue;
+
+      /**
+       * Number of jobs the Endpoint's handler has read() from its group's queue
+      */
+      volatile uint32_t jobs = 0;
+
+      /**
+       * Number of values pend() dropped as ENDPOINT_PENDING_SIZE were already waiting for deliver()
+      */
+      volatile uint32_t pendingDropped = 0;
+
       bool signal();
       bool hasSignals();
       uint8_t getSignals();
 
       void publish(Shared<Message> message);
+
+      /**
+       * Queue value for the Endpoint's own Worker to publish with deliver(). Returns false, counting it
+       * in pendingDropped, if ENDPOINT_PENDING_SIZE values are already queued. Safe from the Dispatcher
+      */
+      bool pend(const uint32_t value);
+
+      /**
+       * Publish each value queued by pend(), oldest first, as the "value" property of a new Message.
+       * Returns false if none. Endpoint's Worker only
+      */
+      bool deliver();
+      /**
+       * Whether a Message was published after publish sequence since
+      */
       bool peek(uint32_t since = 0);
       SharedConst<Message> pull();
 
+      /**
+       * Oldest retained Message published after sequence since, or the latest if since is 0,
+       * advancing since to its sequence. overrun is set if Messages after since have already been overwritten
+      */
+      SharedConst<Message> pull(uint32_t &since, bool &overrun);
+
+      /**
+       * Append all retained Messages published after sequence since, oldest first, advancing since to the
+       * last one's sequence. Returns false on overrun
+      */
+      bool pull(uint32_t &since, std::vector<SharedConst<Message>> &messages);
+
       // absolute_time_t deadlock;
 
       const char* toString();
 
+      ~Endpoint();
+
     protected:
-      Endpoint(const std::string &uri, const Weak<Endpoint> owner);
+      Endpoint(const std::string &uri, const Weak<Endpoint> owner, const uint8_t history, const uint32_t quantum, const Shared<WorkQueue> &queue);
 
     private:
       semaphore_t _signals;
-      Shared<Message> _public;
+
+      /**
+       * Publication ring, single writer (the Endpoint's Worker) multi reader.
+       * Publish sequence s lives in slot s % _capacity. _sequence is the live slot and the slot after it
+       * is the next to be written, so _capacity -1 Messages are retained. Slots are copied & written
+       * under a shared history Lock, see copy().
+      */
+      const uint8_t _capacity;
+      Unique<Shared<Message>[]> _public;
+      volatile uint32_t _sequence = 0;
+
+      uint32_t _pendingValues[ENDPOINT_PENDING_SIZE];
+      volatile uint8_t _pendingHead = 0;
+      volatile uint8_t _pendingCount = 0;
+
+      /**
+       * Bytes of the Endpoint, its URI's heap storage & its publication ring
+      */
+      int32_t footprint() const;
+
+      bool copy(const uint32_t sequence, const uint8_t slot, SharedConst<Message> &message);
 
   };
 
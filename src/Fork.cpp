@@ -0,0 +1,137 @@
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+
+#include "Fork.h"
+#include "Endpoint.h"
+#include "Lock.h"
+#include "Postman.h"
+#include "Supervisor.h"
+#include "Worker.h"
+#include "defs.h"
+
+#include <string>
+
+
+namespace Postman {
+namespace Fork {
+
+  INTERNAL_NS
+
+    Postman::Lock lock("fork");
+    Shared<Endpoint> helpers[FORK_HELPERS ? FORK_HELPERS : 1];
+
+    /**
+     * The range being forked. Chunks are claimed under the Lock, so helpers pick up the next chunk
+     * as they finish rather than being handed a fixed share, and a preempted helper doesn't stall the rest
+    */
+    struct Job {
+      Body body = nullptr;
+      void* context = nullptr;
+      uint32_t next = 0;
+      uint32_t end = 0;
+      uint32_t grain = 1;
+      volatile uint32_t chunks = 0;
+      volatile uint32_t completed = 0;
+      volatile bool busy = false;
+    } job;
+
+    bool claim(uint32_t &from, uint32_t &to, Body &body, void* &context){
+      bool claimed = false;
+      NS::lock.lock();
+        if(NS::job.next < NS::job.end){
+          from = NS::job.next;
+          to = NS::job.end - from > NS::job.grain ? from + NS::job.grain : NS::job.end;
+          body = NS::job.body;
+          context = NS::job.context;
+          NS::job.next = to;
+          claimed = true;
+        }
+      NS::lock.unlock();
+      return claimed;
+    }
+
+    void work(){
+      uint32_t from, to;
+      Body body;
+      void* context;
+      while(NS::claim(from, to, body, context)){
+        body(from, to, context);
+
+        NS::lock.lock();
+          NS::job.completed = NS::job.completed + 1;
+          bool joined = NS::job.completed == NS::job.chunks;
+        NS::lock.unlock();
+        if(joined){
+          Supervisor::wake();   // The caller blocked in run() may now return
+        }
+      }
+    }
+
+    void helper(){
+      while(1){
+        Postman::wait();
+        NS::work();
+      }
+    }
+
+  END_INTERNAL
+
+  void init(){
+    NS::lock.init();
+    for(uint8_t i = 0; i < FORK_HELPERS; i++){
+      Weak<Endpoint> helper = Endpoint::create("/postman/fork/" + std::to_string(i), Endpoint::Empty);
+      NS::helpers[i] = helper.lock();
+      Supervisor::exec(helper, NS::helper);
+    }
+  }
+
+  void run(const uint32_t begin, const uint32_t end, const uint32_t grain, const Body body, void* context){
+    if(end <= begin){
+      return;
+    }
+    uint32_t size = grain ? grain : 1;
+
+    NS::lock.lock();
+      bool forked = FORK_HELPERS && !NS::job.busy;
+      if(forked){
+        NS::job.body = body;
+        NS::job.context = context;
+        NS::job.next = begin;
+        NS::job.end = end;
+        NS::job.grain = size;
+        NS::job.chunks = (end - begin - 1) / size + 1;
+        NS::job.completed = 0;
+        NS::job.busy = true;
+      }
+    NS::lock.unlock();
+
+    if(!forked){    // Nested or concurrent, run inline
+      body(begin, end, context);
+      return;
+    }
+
+    for(uint8_t i = 0; i < FORK_HELPERS; i++){
+      if(NS::helpers[i]){
+        NS::helpers[i]->signal();
+      }
+    }
+    NS::work();
+
+    // Join, freeing this core for the helpers while their last chunks complete
+    auto callback = [](Shared<Endpoint> &source, Weak<Endpoint> target) -> Postman::Result {
+      if(NS::job.completed == NS::job.chunks){
+        return Postman::Result::SUCCESS;
+      }
+      return Postman::Result::CONTINUE;
+    };
+    Supervisor::self()->block(callback, Endpoint::Empty);
+
+    NS::lock.lock();
+      NS::job.busy = false;
+    NS::lock.unlock();
+  }
+
+}}
@@ -0,0 +1,32 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include <stdint.h>
+
+#include "defs.h"
+
+namespace Postman {
+namespace Fork {
+
+  /**
+   * Process [from, to) of a parallel_for() range
+  */
+  typedef void (*Body)(const uint32_t from, const uint32_t to, void* context);
+
+  /**
+   * Open the FORK_HELPERS helper Endpoints, during Supervisor start up
+  */
+  void init();
+
+  /**
+   * Split [begin, end) into chunks of grain, claimed one at a time by the calling handler & the helpers
+   * until none are left, then block the caller until every chunk has completed. Only one range is
+   * forked at a time, a range forked while another is running is run inline by the caller
+   * Handler only. Will block until the range has completed
+  */
+  void run(const uint32_t begin, const uint32_t end, const uint32_t grain, const Body body, void* context);
+
+}}
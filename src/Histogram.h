@@ -0,0 +1,75 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+namespace Postman {
+
+  /**
+   * log2 bucketed histogram, bucket i counts samples in [2^i, 2^(i+1))
+  */
+  struct Histogram {
+    static const uint8_t BUCKETS = 16;
+
+    uint32_t buckets[BUCKETS] = {0};
+    uint32_t count = 0;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t total = 0;
+
+    void add(uint32_t sample){
+      uint8_t bucket = 0;
+      while((sample >> (bucket + 1)) && bucket < BUCKETS - 1){
+        bucket++;
+      }
+      this->buckets[bucket]++;
+      this->count++;
+      this->total += sample;
+      this->min = sample < this->min ? sample : this->min;
+      this->max = sample > this->max ? sample : this->max;
+    }
+
+    void merge(const Histogram &other){
+      for(uint8_t i = 0; i < BUCKETS; i++){
+        this->buckets[i] += other.buckets[i];
+      }
+      this->count += other.count;
+      this->total += other.total;
+      this->min = other.min < this->min ? other.min : this->min;
+      this->max = other.max > this->max ? other.max : this->max;
+    }
+
+    /**
+     * Upper bound of the bucket holding the percentile
+    */
+    uint32_t percentile(uint8_t percent) const {
+      uint32_t rank = (uint64_t) this->count * percent / 100;
+      uint32_t seen = 0;
+      for(uint8_t i = 0; i < BUCKETS; i++){
+        seen += this->buckets[i];
+        if(seen > rank){
+          return (2u << i) - 1;
+        }
+      }
+      return this->max;
+    }
+
+    /**
+     * Print as one JSON line
+    */
+    void print(const char* name, const char* params, const char* unit) const {
+      printf("{\"benchmark\":\"%s\",\"params\":\"%s\",\"unit\":\"%s\",\"samples\":%lu,\"mean\":%lu,\"min\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu,\"histogram\":[",
+        name, params, unit, (unsigned long) this->count, (unsigned long) (this->count ? this->total / this->count : 0),
+        (unsigned long) (this->count ? this->min : 0), (unsigned long) this->percentile(50), (unsigned long) this->percentile(99), (unsigned long) this->max);
+      for(uint8_t i = 0; i < BUCKETS; i++){
+        printf(i ? ",%lu" : "%lu", (unsigned long) this->buckets[i]);
+      }
+      printf("]}\n");
+    }
+  };
+
+}
@@ -0,0 +1,61 @@
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+
+#include <stdio.h>
+
+#include "Lock.h"
+
+
+namespace Postman {
+
+  INTERNAL_NS
+    Lock* locks[LOCK_PROFILE_SIZE];
+    uint8_t count = 0;
+  END_INTERNAL
+
+  void Lock::init(){
+    int spinlock = spin_lock_claim_unused(false);
+    if(spinlock >= 0){
+      critical_section_init_with_lock_num(&this->_crit_sec, spinlock);
+    }
+    else {
+      critical_section_init(&this->_crit_sec);
+    }
+    this->_stats = Stats();
+
+    if(NS::count < LOCK_PROFILE_SIZE){
+      NS::locks[NS::count++] = this;
+    }
+  }
+
+  Lock::Stats Lock::stats(){
+    // Acquire without profiling so reading doesn't skew the profile
+    uint32_t save = spin_lock_blocking(this->_crit_sec.spin_lock);
+    Stats stats = this->_stats;
+    spin_unlock(this->_crit_sec.spin_lock, save);
+    return stats;
+  }
+
+  uint8_t Lock::count(){
+    return NS::count;
+  }
+
+  Lock* Lock::at(uint8_t index){
+    if(index < NS::count){
+      return NS::locks[index];
+    }
+    return nullptr;
+  }
+
+  void Lock::report(){
+    for(uint8_t i = 0; i < NS::count; i++){
+      Lock::Stats stats = NS::locks[i]->stats();
+      printf("Lock: %s  Acquired: %lu  Contended: %lu  Spin total: %llu us  Spin max: %lu us  Hold max: %lu us\n",
+        NS::locks[i]->name, stats.acquisitions, stats.contended, stats.spinTotal, stats.spinMax, stats.holdMax);
+    }
+  }
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include "pico/sync.h"
+#include "pico/time.h"
+#include "defs.h"
+
+namespace Postman {
+
+  /**
+   * Named spinlock & interrupt disabling critical section.
+   * With LOCK_PROFILING each Lock records how often, and for how long, both cores contend on it
+  */
+  class Lock {
+
+    public:
+      struct Stats {
+        uint32_t acquisitions = 0;
+        uint32_t contended = 0;   // Acquisitions that had to spin
+        uint64_t spinTotal = 0;   // us
+        uint32_t spinMax = 0;     // us
+        uint32_t holdMax = 0;     // us
+      };
+
+      const char* const name;
+
+      explicit Lock(const char* name) : name(name){}
+
+      /**
+       * Claim an unused hardware spinlock, falling back to a shared striped one, and register for profiling
+      */
+      void init();
+
+      __force_inline void lock(){
+        uint32_t save = save_and_disable_interrupts();
+        spin_lock_t* spin = this->_crit_sec.spin_lock;
+
+        if(LOCK_PROFILING){
+          if(!*spin){   // Reading a free hardware spinlock claims it
+            uint32_t start = time_us_32();
+            while(!*spin){
+              tight_loop_contents();
+            }
+            uint32_t spun = time_us_32() - start;
+            this->_stats.contended++;
+            this->_stats.spinTotal += spun;
+            if(spun > this->_stats.spinMax){
+              this->_stats.spinMax = spun;
+            }
+          }
+          __mem_fence_acquire();
+          this->_stats.acquisitions++;
+          this->_acquired = time_us_32();
+        }
+        else {
+          spin_lock_unsafe_blocking(spin);
+        }
+        this->_crit_sec.save = save;
+      }
+
+      __force_inline void unlock(){
+        if(LOCK_PROFILING){
+          uint32_t held = time_us_32() - this->_acquired;
+          if(held > this->_stats.holdMax){
+            this->_stats.holdMax = held;
+          }
+        }
+        spin_unlock(this->_crit_sec.spin_lock, this->_crit_sec.save);
+      }
+
+      /**
+       * Consistent copy of the Lock's profile
+      */
+      Stats stats();
+
+      static uint8_t count();
+      static Lock* at(uint8_t index);
+
+      /**
+       * printf() the profile of every registered Lock
+      */
+      static void report();
+
+    private:
+      critical_section_t _crit_sec;
+      Stats _stats;
+      uint32_t _acquired = 0;
+  };
+
+};
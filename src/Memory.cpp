@@ -0,0 +1,165 @@
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+
+#include "Memory.h"
+#include "Dispatcher.h"
+#include "Endpoint.h"
+#include "Lock.h"
+#include "Supervisor.h"
+#include "Worker.h"
+#include "defs.h"
+
+
+namespace Postman {
+namespace Memory {
+
+  INTERNAL_NS
+
+    Postman::Lock lock("memory");
+    Usage usage[Subsystem::SUBSYSTEMS];
+
+    const char* names[Subsystem::SUBSYSTEMS] = {
+      "kernel",
+      "workers",
+      "endpoints",
+      "messages",
+      "properties",
+      "buffers",
+    };
+
+    void account(const Subsystem subsystem, const int32_t bytes){
+      NS::lock.lock();
+        Usage &usage = NS::usage[subsystem];
+        usage.current += bytes;
+        if(bytes >= 0){
+          usage.allocations++;
+          usage.peak = usage.current > usage.peak ? usage.current : usage.peak;
+        }
+        else {
+          usage.frees++;
+        }
+      NS::lock.unlock();
+
+      // Attribute allocations to the Endpoint whose handler made them, frees may happen anywhere
+      if(bytes > 0 && Supervisor::dispatcher()){
+        Worker* self = Supervisor::self();
+        if(self && self->endpoint){
+          self->endpoint->allocations++;
+          self->endpoint->allocated += bytes;
+        }
+      }
+    }
+
+    /**
+     * Fixed size blocks, free ones linked through their first word. Blocks are returned to the pool
+     * whose storage they lie in, so pooled & heap blocks can be freed alike
+    */
+    struct Pool {
+      const size_t block;
+      const uint32_t count;
+      uint8_t* const storage;
+      void* free = nullptr;
+      uint32_t available = 0;
+
+      constexpr Pool(const size_t block, const uint32_t count, uint8_t* const storage) :
+        block(block), count(count), storage(storage){}
+
+      bool owns(const void* pointer) const {
+        return pointer >= this->storage && pointer < this->storage + this->block * this->count;
+      }
+    };
+
+    uint8_t __attribute__((aligned(8))) storage16[16 * MEMORY_POOL_16];
+    uint8_t __attribute__((aligned(8))) storage32[32 * MEMORY_POOL_32];
+    uint8_t __attribute__((aligned(8))) storage64[64 * MEMORY_POOL_64];
+    uint8_t __attribute__((aligned(8))) storage128[128 * MEMORY_POOL_128];
+
+    Pool pools[] = {
+      { 16, MEMORY_POOL_16, NS::storage16 },
+      { 32, MEMORY_POOL_32, NS::storage32 },
+      { 64, MEMORY_POOL_64, NS::storage64 },
+      { 128, MEMORY_POOL_128, NS::storage128 },
+    };
+
+    const uint8_t POOLS = sizeof(NS::pools) / sizeof(Pool);
+
+    Pool* pool(const size_t bytes){
+      for(uint8_t i = 0; i < NS::POOLS; i++){
+        if(bytes <= NS::pools[i].block){
+          return &NS::pools[i];
+        }
+      }
+      return nullptr;
+    }
+
+    void* allocate(const size_t bytes){
+      Pool* pool = NS::pool(bytes);
+      void* block = nullptr;
+      if(pool){
+        NS::lock.lock();
+          block = pool->free;
+          if(block){
+            pool->free = *static_cast<void**>(block);
+            pool->available--;
+          }
+        NS::lock.unlock();
+      }
+      return block;   // The heap serves it when the pool is exhausted
+    }
+
+    bool free(void* pointer){
+      for(uint8_t i = 0; i < NS::POOLS; i++){
+        Pool &pool = NS::pools[i];
+        if(pool.owns(pointer)){
+          NS::lock.lock();
+            *static_cast<void**>(pointer) = pool.free;
+            pool.free = pointer;
+            pool.available++;
+          NS::lock.unlock();
+          return true;
+        }
+      }
+      return false;
+    }
+
+  END_INTERNAL
+
+  void init(){
+    NS::lock.init();
+    if(MEMORY_ACCOUNTING){
+      Memory::hook() = NS::account;
+    }
+    if(MEMORY_POOLS){
+      for(uint8_t i = 0; i < NS::POOLS; i++){
+        NS::Pool &pool = NS::pools[i];
+        for(uint32_t b = 0; b < pool.count; b++){
+          void* block = pool.storage + b * pool.block;
+          *static_cast<void**>(block) = pool.free;
+          pool.free = block;
+        }
+        pool.available = pool.count;
+      }
+      Memory::heap() = { NS::allocate, NS::free };
+    }
+  }
+
+  uint32_t available(const size_t bytes){
+    NS::Pool* pool = NS::pool(bytes);
+    return MEMORY_POOLS && pool ? pool->available : 0;
+  }
+
+  Usage usage(const Subsystem subsystem){
+    NS::lock.lock();
+      Usage usage = NS::usage[subsystem];
+    NS::lock.unlock();
+    return usage;
+  }
+
+  const char* name(const Subsystem subsystem){
+    return subsystem < Subsystem::SUBSYSTEMS ? NS::names[subsystem] : "";
+  }
+
+}}
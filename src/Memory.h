@@ -0,0 +1,152 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+#include "defs.h"
+
+/**
+ * Kernel allocation by subsystem. Allocations report their size to a hook, installed by Memory::init()
+ * on device, which tracks current & peak bytes per subsystem and allocations per owning Endpoint.
+ * With MEMORY_POOLS, small blocks come from fixed size pools instead of the shared heap, giving
+ * constant allocation time and no fragmentation, falling back to the heap when a pool is exhausted.
+ * Portable, so headers shared with the host allocate through it
+*/
+
+namespace Postman {
+namespace Memory {
+
+  enum Subsystem : uint8_t {
+    // Only heap allocations are counted, the Worker pool, Dispatchers, Message bank & Buffer pool are static
+    KERNEL,       // Supervisor
+    WORKERS,      // Workers
+    ENDPOINTS,    // Endpoints, their URIs & publication rings
+    MESSAGES,     // Fall back Messages & shared_ptr control blocks
+    PROPERTIES,   // Property map nodes & value holders, not the heap storage of std::string keys & values
+    BUFFERS,      // Buffer shared_ptr control blocks
+    SUBSYSTEMS,
+  };
+
+  struct Usage {
+    int32_t current = 0;        // bytes
+    int32_t peak = 0;           // bytes
+    uint32_t allocations = 0;   // Total, the rate is the change between samples
+    uint32_t frees = 0;
+  };
+
+  typedef void (*Hook)(const Subsystem subsystem, const int32_t bytes);
+
+  inline Hook& hook(){
+    static Hook hook = nullptr;
+    return hook;
+  }
+
+  /**
+   * Report bytes allocated, or freed if negative
+  */
+  inline void account(const Subsystem subsystem, const int32_t bytes){
+    if(MEMORY_ACCOUNTING && Memory::hook()){
+      Memory::hook()(subsystem, bytes);
+    }
+  }
+
+  /**
+   * Block allocator hooks, returning null or false for blocks they don't serve
+  */
+  struct Heap {
+    void* (*allocate)(const size_t bytes);
+    bool (*free)(void* pointer);
+  };
+
+  inline Heap& heap(){
+    static Heap heap = { nullptr, nullptr };
+    return heap;
+  }
+
+  inline void* allocate(const Subsystem subsystem, const size_t bytes){
+    Memory::account(subsystem, bytes);
+    void* pointer = Memory::heap().allocate ? Memory::heap().allocate(bytes) : nullptr;
+    return pointer ? pointer : ::operator new(bytes);
+  }
+
+  inline void free(const Subsystem subsystem, void* pointer, const size_t bytes){
+    Memory::account(subsystem, -(int32_t) bytes);
+    if(!Memory::heap().free || !Memory::heap().free(pointer)){
+      ::operator delete(pointer);
+    }
+  }
+
+  /**
+   * Base for classes allocated with new, routing them through allocate() & free() for subsystem.
+   * Classes with a virtual destructor are freed with their dynamic size
+  */
+  template<Subsystem S>
+  struct Allocated {
+    static void* operator new(size_t bytes){
+      return Memory::allocate(S, bytes);
+    }
+
+    static void operator delete(void* pointer, size_t bytes){
+      Memory::free(S, pointer, bytes);
+    }
+  };
+
+  /**
+   * std::allocator for subsystem, for containers and the control blocks of shared_ptrs
+  */
+  template<typename T, Subsystem S>
+  struct Allocator {
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind {
+      typedef Allocator<U, S> other;
+    };
+
+    Allocator() = default;
+
+    template<typename U>
+    Allocator(const Allocator<U, S>&){}
+
+    T* allocate(size_t count){
+      return static_cast<T*>(Memory::allocate(S, count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t count){
+      Memory::free(S, pointer, count * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const Allocator<U, S>&) const {
+      return true;
+    }
+
+    template<typename U>
+    bool operator!=(const Allocator<U, S>&) const {
+      return false;
+    }
+  };
+
+  /**
+   * Install the accounting hook and pools. Allocations made before init() are not counted or pooled
+  */
+  void init();
+
+  /**
+   * Free blocks left in the pool serving bytes, 0 if none does
+  */
+  uint32_t available(const size_t bytes);
+
+  /**
+   * Usage of subsystem so far
+  */
+  Usage usage(const Subsystem subsystem);
+
+  const char* name(const Subsystem subsystem);
+
+}}
@@ -6,37 +6,53 @@
 
 #include "Message.h"
 #include "Endpoint.h"
+#include "Memory.h"
 #include "Queue.h"
 #include "defs.h"
 
 namespace Postman {
   INTERNAL_NS
     uint32_t messageId = 0;
-    Postman::Queue messages;
+    Postman::Queue messages("messages");
+    uint8_t __attribute__((aligned(alignof(Message)))) bank[sizeof(Message) * MESSAGE_BANK_SIZE];   // Placed statically, constructed by init()
 
     void release(Message* message){
       message->clear();
+      message->attach(nullptr);
+      message->published = 0;
       NS::messages.push(message);
     }
   END_INTERNAL
 
   void Message::init(){
-    NS::messages = Queue();
+    NS::messages.init();
 
-    Message* MessageBank = new Message[MESSAGE_BANK_SIZE];
+    Message* MessageBank = reinterpret_cast<Message*>(NS::bank);
     for (int i = 0; i < MESSAGE_BANK_SIZE; i++) {
-      NS::messages.push(&MessageBank[i]);
+      NS::messages.push(new (&MessageBank[i]) Message());
     }
   }
 
+  uint32_t Message::available(){
+    return NS::messages.length();
+  }
+
+  void Message::attach(Shared<Buffer> buffer){
+    this->_payload = buffer;
+  }
+
+  SharedConst<Buffer> Message::buffer() const {
+    return this->_payload;
+  }
+
   Shared<Message> Message::create(Shared<Endpoint> origin){
     Message* free = (Message*) NS::messages.pop();
     Shared<Message> message;
     if(free){
-      message = Shared<Message>(free, NS::release);
+      message = Shared<Message>(free, NS::release, Memory::Allocator<Message, Memory::MESSAGES>());
     }
     else {  // Fall back and allow shared_ptr to clean up
-      message = Shared<Message>(new Message());
+      message = std::allocate_shared<Message>(Memory::Allocator<Message, Memory::MESSAGES>());
     }
     message->origin = origin;
     message->id = ++NS::messageId;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Node.h"
+#include "Buffer.h"
 #include "Properties.h"
 #include "pointers.h"
 
@@ -12,8 +13,42 @@ namespace Postman {
       static void init();
       static Shared<Message> create(Shared<Endpoint> origin);
 
+      /**
+       * Number of Messages free in the bank
+      */
+      static uint32_t available();
+
       Weak<Endpoint> origin;
       uint32_t id;
+
+      /**
+       * Time of publish() in us since boot, set while TRACE to measure publish to fetch latency
+      */
+      uint64_t published = 0;
+
+      /**
+       * Attach a binary payload by reference, replacing any previous one
+      */
+      void attach(Shared<Buffer> buffer);
+
+      /**
+       * Read only view of the attached payload as T, empty if none
+      */
+      template<typename T = uint8_t>
+      Span<const T> payload() const {
+        if(this->_payload){
+          return this->_payload->view<T>();
+        }
+        return Span<const T>();
+      }
+
+      /**
+       * The attached Buffer, to hold the payload beyond the Message
+      */
+      SharedConst<Buffer> buffer() const;
+
+    private:
+      Shared<Buffer> _payload;
   };
 }
 
@@ -5,35 +5,165 @@
 
 
 #include "Postman.h"
+#include "Clock.h"
 #include "Supervisor.h"
 #include "Worker.h"
+#include "Dispatcher.h"
 #include "Endpoint.h"
+#include "Trace.h"
+#include "WorkQueue.h"
+#include "defs.h"
 
 
 
 namespace Postman {
 
+  INTERNAL_NS
+
+    /**
+     * Block the current handler until target publishes a Message newer than since
+    */
+    Postman::Result await(const std::string &target, uint32_t since, uint32_t timeout_ms, Shared<Endpoint> &endpoint){
+      Worker* self = Supervisor::self();
+      endpoint = Endpoint::get(target);
+      if(!endpoint || endpoint == self->endpoint){  // Can't block on self
+        return Postman::Result::ENDPOINT_NOT_AVAILABLE;
+      }
+
+      self->endpoint->data = static_cast<void*>(&since);
+
+      Weak<Endpoint> weakTarget = endpoint;
+      endpoint.reset(); // Release shared pointer lock
+
+      auto callback = [](Shared<Endpoint> &source, Weak<Endpoint> target) -> Postman::Result {
+        Shared<Endpoint> endpoint = target.lock();
+        if(endpoint){
+          uint32_t since = *static_cast<uint32_t*>(source->data);
+          if(endpoint->peek(since)){
+            return Postman::Result::SUCCESS;
+          }
+          return Postman::Result::CONTINUE;
+        }
+        return Postman::Result::ENDPOINT_NOT_AVAILABLE;
+      };
+
+      Postman::Result result = self->block(callback, weakTarget, timeout_ms);
+      if(result == Postman::Result::SUCCESS){
+        endpoint = weakTarget.lock();
+        if(!endpoint){
+          return Postman::Result::ENDPOINT_NOT_AVAILABLE;
+        }
+      }
+      return result;
+    }
+
+  END_INTERNAL
+
   void start(const std::string &appUri, const Endpoint::Handler &appHandler) {
-    Supervisor::start(appUri, appHandler);
+    Supervisor::start(appUri, appHandler, nullptr, 0);
     printf("Postman Started\n");
   }
 
-  bool open(const std::string &uri, const Endpoint::Handler &handler) {
+  void start(const std::string &appUri, const Endpoint::Handler &appHandler, const Endpoint::Declaration* topology, const uint8_t count) {
+    Supervisor::start(appUri, appHandler, topology, count);
+  }
+
+  bool open(const std::string &uri, const Endpoint::Handler &handler, const uint8_t history, const uint32_t quantum_us) {
     Worker* self = Supervisor::self();
-    Weak<Endpoint> endpoint = Endpoint::create(uri, self->endpoint);
+    Weak<Endpoint> endpoint = Endpoint::create(uri, self->endpoint, history, quantum_us);
     if(!Endpoint::isEmpty(endpoint)){
       return Supervisor::exec(endpoint, handler);
     }
     return false;
   }
 
+  uint8_t open_group(const std::string &uri, const Endpoint::Handler &handler, const uint8_t consumers, const uint8_t capacity) {
+    Worker* self = Supervisor::self();
+    Shared<WorkQueue> queue(new WorkQueue(Endpoint::hash(uri.c_str()), capacity));
+
+    // Every Endpoint is registered with its queue before any consumer runs, and all are released if one can't be
+    std::vector<Weak<Endpoint>> group;
+    group.reserve(consumers + 1);
+    group.push_back(Endpoint::create(uri, self->endpoint, 0, 0, queue));
+    for(uint8_t i = 0; i < consumers && !Endpoint::isEmpty(group.back()); i++){
+      group.push_back(Endpoint::create(uri + "/" + std::to_string(i), self->endpoint, 0, 0, queue));
+    }
+
+    uint8_t started = 0;
+    if(!Endpoint::isEmpty(group.back())){
+      while(started < consumers && Supervisor::exec(group[started + 1], handler)){
+        started++;
+      }
+    }
+
+    // Consumers that couldn't start are released, and the queue too if none did
+    for(size_t i = started ? started + 1 : 0; i < group.size(); i++){
+      Endpoint::release(group[i]);
+    }
+    return started;
+  }
+
+  bool post(SharedConst<Message> message, const std::string target, const uint32_t duration_ms) {
+    Worker* self = Supervisor::self();
+    Shared<Endpoint> endpoint = Endpoint::get(target);
+    if(!endpoint || !endpoint->queue){
+      return false;
+    }
+    self->endpoint->data = static_cast<void*>(&message);
+
+    Weak<Endpoint> weakTarget = endpoint;
+    endpoint.reset(); // Release shared pointer lock
+
+    auto callback = [](Shared<Endpoint> &source, Weak<Endpoint> target) -> Postman::Result {
+      Shared<Endpoint> endpoint = target.lock();
+      if(endpoint){
+        if(endpoint->queue->put(*static_cast<SharedConst<Message>*>(source->data))){
+          return Postman::Result::SUCCESS;
+        }
+        return Postman::Result::CONTINUE;
+      }
+      return Postman::Result::ENDPOINT_NOT_AVAILABLE;
+    };
+
+    return self->block(callback, weakTarget, duration_ms) == Postman::Result::SUCCESS;
+  }
+
+  SharedConst<Message> read(uint32_t timeout_ms) {
+    Worker* self = Supervisor::self();
+    SharedConst<Message> job;
+    if(!self->endpoint->queue){
+      return job;
+    }
+    self->endpoint->data = static_cast<void*>(&job);
+
+    auto callback = [](Shared<Endpoint> &source, Weak<Endpoint> target) -> Postman::Result {
+      SharedConst<Message> &job = *static_cast<SharedConst<Message>*>(source->data);
+      job = source->queue->take();
+      return job ? Postman::Result::SUCCESS : Postman::Result::CONTINUE;
+    };
+
+    if(self->block(callback, Endpoint::Empty, timeout_ms) == Postman::Result::SUCCESS){
+      self->endpoint->jobs = self->endpoint->jobs + 1;
+      return job;
+    }
+    return nullptr;
+  }
+
+  void parallel_for(const uint32_t begin, const uint32_t end, const uint32_t grain, const Fork::Body body, void* context) {
+    Fork::run(begin, end, grain, body, context);
+  }
+
   void close(){
     Worker* self = Supervisor::self();
     self->halt();
   }
 
   void yield(){
+    if(Supervisor::alone(Clock::now())){
+      return;   // Nothing else is runnable, the trap would only dispatch this Worker again
+    }
     Worker::yield();
+    Supervisor::self()->endpoint->deliver();
   }
 
   void sleep(const uint32_t duration_ms){
@@ -41,6 +171,11 @@ namespace Postman {
     self->sleep(duration_ms);
   }
 
+  void periodic(const uint32_t period_us, const uint32_t deadline_us){
+    Worker* self = Supervisor::self();
+    self->periodic(period_us, deadline_us);
+  }
+
   uint8_t wait(const uint32_t timeout){
     Worker* self = Supervisor::self();
 
@@ -51,7 +186,8 @@ namespace Postman {
       return Postman::Result::CONTINUE;
     };
     Postman::Result result = self->block(callback, Endpoint::Empty, timeout);
-    // Handler resumes here
+    // Handler resumes here. block() delivered if it yielded, otherwise values may have arrived while running
+    self->endpoint->deliver();
     if(result == Postman::Result::SUCCESS){
       return self->endpoint->getSignals();
     }
@@ -92,6 +228,46 @@ namespace Postman {
     return false;
   }
 
+  uint16_t notify_group(const std::string pattern){
+    Worker* self = Supervisor::self();
+    uint16_t signalled = 0;
+
+    // Members are collected on the stack, a batch per registry Lock acquisition, and signalled after it is
+    // released, as signal() takes the semaphore's spinlock. Each pass skips the members already signalled
+    struct Members {
+      uint16_t skip;
+      uint8_t count;
+      Shared<Endpoint> endpoints[NOTIFY_GROUP_BATCH];
+    } members;
+
+    auto visitor = [](Endpoint &endpoint, void* data){
+      Members* members = static_cast<Members*>(data);
+      if(members->skip){
+        members->skip--;
+      }
+      else if(members->count < NOTIFY_GROUP_BATCH){
+        members->endpoints[members->count++] = endpoint.shared_from_this();
+      }
+    };
+
+    uint16_t visited = 0;
+    uint16_t matched;
+    do {
+      members.skip = visited;
+      members.count = 0;
+      matched = Endpoint::each(pattern, visitor, &members);
+      for(uint8_t i = 0; i < members.count; i++){
+        if(members.endpoints[i] != self->endpoint && members.endpoints[i]->signal()){
+          signalled++;
+        }
+        members.endpoints[i].reset();
+      }
+      visited += members.count;
+    } while(members.count && visited < matched);
+    // Workers wait()ing resume on the next pass
+    return signalled;
+  }
+
   bool peek(const std::string target, uint32_t since){
     Shared<Endpoint> endpoint = Endpoint::get(target);
     if(endpoint){
@@ -100,40 +276,73 @@ namespace Postman {
     return false;
   }
 
-  SharedConst<Message> fetch(const std::string target, uint32_t since, uint32_t timeout_ms){
-    Worker* self = Supervisor::self();
-    Shared<Endpoint> endpoint = Endpoint::get(target);
-    if(!endpoint || endpoint == self->endpoint){  // Can't block on self
-      return nullptr;
-    }
-
-    self->endpoint->data = static_cast<void*>(&since);
-
-    Weak<Endpoint> weakTarget = endpoint;
-    endpoint.reset(); // Release shared pointer lock
-
-    auto callback = [](Shared<Endpoint> &source, Weak<Endpoint> target) -> Postman::Result {
-      Shared<Endpoint> endpoint = target.lock();
-      if(endpoint){
-        uint32_t since = *static_cast<uint32_t*>(source->data);
-        if(endpoint->peek(since)){
-          return Postman::Result::SUCCESS;
-        }
-        return Postman::Result::CONTINUE;
+  SharedConst<Message> fetch(const std::string target, uint32_t since, uint32_t timeout_ms, uint32_t* sequence){
+    Shared<Endpoint> endpoint;
+    Postman::Result result = NS::await(target, since, timeout_ms, endpoint);
+    // Handler resumes here
+    if(result == Postman::Result::SUCCESS){
+      bool overrun;
+      SharedConst<Message> message = endpoint->pull(since, overrun);    // since is a copy
+      if(sequence && message){
+        *sequence = since;
       }
-      return Postman::Result::ENDPOINT_NOT_AVAILABLE;
-    };
+      if(TRACE && message){
+        Trace::fetched(*endpoint, *message);
+      }
+      return message;
+    }
+    return nullptr;
+  }
 
-    Postman::Result result = self->block(callback, weakTarget, timeout_ms);
+  Postman::Result fetch(const std::string target, std::vector<SharedConst<Message>> &messages, uint32_t since, uint32_t timeout_ms,
+    uint32_t* sequence){
+    Shared<Endpoint> endpoint;
+    Postman::Result result = NS::await(target, since, timeout_ms, endpoint);
     // Handler resumes here
     if(result == Postman::Result::SUCCESS){
-      endpoint = Endpoint::get(target);
-      if(endpoint){
-        SharedConst<Message> message = endpoint->pull();
-        return message;
+      size_t first = messages.size();
+      bool lossless = endpoint->pull(since, messages);
+      if(sequence && messages.size() > first){
+        *sequence = since;
+      }
+      for(size_t i = first; TRACE && i < messages.size(); i++){
+        Trace::fetched(*endpoint, *messages[i]);
+      }
+      if(!lossless){
+        return Postman::Result::MESSAGE_OVERRUN;
       }
     }
-    return nullptr;
+    return result;
+  }
+
+  std::vector<Shared<Endpoint>> match(const std::string pattern){
+    std::vector<Shared<Endpoint>> endpoints;
+    Endpoint::match(pattern, endpoints);
+    return endpoints;
+  }
+
+  Shared<Endpoint> handle(const std::string target){
+    return Endpoint::get(target);
+  }
+
+  Shared<Endpoint> handle(const Endpoint::Declaration &declared){
+    return Endpoint::get(declared.key, declared.uri);
+  }
+
+  bool isr_notify(const Shared<Endpoint> &handle){
+    Dispatcher* dispatcher = Supervisor::dispatcher();
+    if(!handle || !dispatcher){
+      return false;
+    }
+    return dispatcher->defer(handle, false);
+  }
+
+  bool isr_post(const Shared<Endpoint> &handle, const uint32_t value){
+    Dispatcher* dispatcher = Supervisor::dispatcher();
+    if(!handle || !dispatcher){
+      return false;
+    }
+    return dispatcher->defer(handle, true, value);
   }
 
   Shared<Message> compose(){
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "Uri.h"
 
 #include "Endpoint.h"
+#include "Fork.h"
 #include "Message.h"
 #include "defs.h"
 #include "pointers.h"
@@ -15,10 +17,61 @@ namespace Postman {
   void start(const std::string &appUri, const Endpoint::Handler &handler);
 
   /**
-   * Open new Endpoint URI with handler. Returns success
+   * Start Postman with root Endpoint URI and handler, and a static topology of Endpoints owned by it.
+   * The topology is opened during start up, before any handler runs, rather than by open() calls
+  */
+  void start(const std::string &appUri, const Endpoint::Handler &handler, const Endpoint::Declaration* topology, const uint8_t count);
+
+  template<uint8_t N>
+  void start(const std::string &appUri, const Endpoint::Handler &handler, const Endpoint::Declaration (&topology)[N]) {
+    Postman::start(appUri, handler, topology, N);
+  }
+
+  namespace detail {
+
+    /**
+     * Whether key is held by any of topology from index from on
+    */
+    template<uint8_t N>
+    constexpr bool occurs(const Endpoint::Declaration (&topology)[N], const uint32_t key, const uint8_t from) {
+      return from < N && (topology[from].key == key || detail::occurs(topology, key, from + 1));
+    }
+
+  }
+
+  /**
+   * Whether the keys of topology are unique, so no two of its Endpoints share a probe chain.
+   * Recursion is at most N deep, for use in a static_assert
+  */
+  template<uint8_t N>
+  constexpr bool distinct(const Endpoint::Declaration (&topology)[N], const uint8_t i = 0) {
+    return i >= N || (!detail::occurs(topology, topology[i].key, i + 1) && Postman::distinct(topology, i + 1));
+  }
+
+  /**
+   * Open new Endpoint URI with handler, optionally retaining the last history published Messages
+   * for fetch(), and with a time slice of quantum_us (0 for the default, at most Endpoint::MAX_QUANTUM). Returns success
    * Handler only
   */
-  bool open(const std::string &uri, const Endpoint::Handler &handler);
+  bool open(const std::string &uri, const Endpoint::Handler &handler, const uint8_t history = 0, const uint32_t quantum_us = 0);
+
+  /**
+   * Open a work queue Endpoint at uri holding up to capacity jobs, and a group of consumers Endpoints
+   * "uri/0", "uri/1" ... each running handler. Jobs post()ed to uri are read() by whichever consumer
+   * asks next, on either core, so CPU heavy work spreads across both cores without sharding.
+   * Returns the number of consumers started, which may be fewer than consumers if the Worker pool runs out.
+   * If none started, or any Endpoint of the group couldn't be created, every Endpoint of the group is released
+   * Handler only
+  */
+  uint8_t open_group(const std::string &uri, const Endpoint::Handler &handler, const uint8_t consumers, const uint8_t capacity = WORK_QUEUE_SIZE);
+
+  /**
+   * Run body over [begin, end) in chunks of grain, spread across the calling handler and the FORK_HELPERS
+   * helper Workers on both cores, returning once every chunk has completed. The caller works through
+   * chunks too, then blocks, freeing its core, until the helpers finish theirs
+   * Handler only. Will block until the range has completed
+  */
+  void parallel_for(const uint32_t begin, const uint32_t end, const uint32_t grain, const Fork::Body body, void* context = nullptr);
 
   /**
    * Close the current Endpoint and free the underlying Worker
@@ -39,14 +92,22 @@ namespace Postman {
   void sleep(const uint32_t duration_ms);
 
   /**
-   * Post Message to target Endpoint.
-   * Handler only. Will block until success or timeout
+   * Run the current handler periodically. Each call completes the current job and sleeps until the next
+   * release, period_us after the previous one. A job completing after deadline_us from its release
+   * (default the period) counts as a deadline miss. The first call releases immediately
+   * Handler only.
+  */
+  void periodic(const uint32_t period_us, const uint32_t deadline_us = 0);
+
+  /**
+   * Post Message as a job to the work queue Endpoint target, see open_group().
+   * Handler only. Will block until queued or timeout, returns false if target isn't a work queue
   */
   bool post(SharedConst<Message> message, const std::string target, const uint32_t duration_ms);
 
   /**
-   * Read Message post()ed by a source Endpoint
-   * Handler only. Will block until success or timeout
+   * Read the next job post()ed to the current Endpoint's consumer group
+   * Handler only. Will block until a job or timeout, returns null on timeout or outside a group
   */
   SharedConst<Message> read(uint32_t timeout_ms);
   
@@ -57,10 +118,21 @@ namespace Postman {
   void publish(Shared<Message> message);
 
   /**
-   * Fetch public Message by target Endpoint newer than since with timeout
+   * Fetch the next public Message by target Endpoint published after since with timeout, or the latest if since is 0.
+   * Its publish sequence on target is set in sequence unless null. Successive calls passing the last sequence
+   * as since walk the target's retained history without loss
    * Handler only. Will block until success or timeout
   */
-  SharedConst<Message> fetch(const std::string target, uint32_t since = 0, uint32_t timeout_ms = 0);
+  SharedConst<Message> fetch(const std::string target, uint32_t since = 0, uint32_t timeout_ms = 0, uint32_t* sequence = nullptr);
+
+  /**
+   * Fetch every retained public Message by target Endpoint published after sequence since, oldest first, with timeout.
+   * The last one's publish sequence is set in sequence unless null.
+   * Returns MESSAGE_OVERRUN if Messages published after since were overwritten before they could be fetched
+   * Handler only. Will block until success or timeout
+  */
+  Postman::Result fetch(const std::string target, std::vector<SharedConst<Message>> &messages, uint32_t since = 0, uint32_t timeout_ms = 0,
+    uint32_t* sequence = nullptr);
 
   /**
    * Get property last published by target with timeout
@@ -101,12 +173,53 @@ namespace Postman {
   */
   bool notify(const std::string target, uint32_t timeout_ms = 0);
 
+  /**
+   * Notify every Endpoint matching pattern, see match(), resolved in a single pass. Returns the number signalled.
+   * Endpoints already holding the maximum number of signals are skipped
+   * Handler only. Will not block
+  */
+  uint16_t notify_group(const std::string pattern);
+
   /**
    * Wait until current Endpoint recieves at least 1 signal, return the total num signals and reset
    * Handler only. Will block until at least 1 signal or timeout
   */
   uint8_t wait(const uint32_t timeout = 0);
 
+  /**
+   * Handles of every open Endpoint matching pattern. A "*" segment matches any one segment,
+   * a trailing "**" segment matches the parent Endpoint and its whole subtree
+   * Will not block
+  */
+  std::vector<Shared<Endpoint>> match(const std::string pattern);
+
+  /**
+   * Resolve target Endpoint to a handle for the isr_ functions. The handle keeps the Endpoint alive while held
+   * Will not block
+  */
+  Shared<Endpoint> handle(const std::string target);
+
+  /**
+   * Resolve a declared Endpoint to a handle by its precomputed key, without building a string
+   * Will not block
+  */
+  Shared<Endpoint> handle(const Endpoint::Declaration &declared);
+
+  /**
+   * Notify target Endpoint from an interrupt handler. The signal is deferred to the current core's
+   * Dispatcher, which preempts the running handler to deliver it
+   * Interrupt safe. Will not block, returns false if the deferred queue is full
+  */
+  bool isr_notify(const Shared<Endpoint> &handle);
+
+  /**
+   * Hand value from an interrupt handler to target Endpoint, and signal it. The target's handler publishes
+   * it as the "value" property of a new Message when it next returns from wait(), so the target should wait()
+   * for it. A newer value replaces one not yet published
+   * Interrupt safe. Will not block, returns false if the deferred queue is full
+  */
+  bool isr_post(const Shared<Endpoint> &handle, const uint32_t value);
+
   /**
    * Compose new shared Message with current Endpoint as the origin.  Allocates Message from MessageBank
    * and returns to the bank when it goes out of scope in all consumers.
@@ -1,30 +1,48 @@
+#pragma once
 /**
  * @copyright Copyright (C) 2023 Neil Stansbury
  * All rights reserved.
  */
 
+#include "Memory.h"
 #include "pointers.h"
 
 #include <string>
 #include <map>
+#include <utility>
 
 
+/**
+ * Compile-time per-type tag without RTTI, the address of TypeTag<T>::id is unique for each T
+*/
+template<class T>
+struct TypeTag {
+  static const char id;
+};
 template<class T>
-class PropertyDescriptor;
+const char TypeTag<T>::id = 0;
 
-class PropertyType {
+
+class PropertyType : public Postman::Memory::Allocated<Postman::Memory::PROPERTIES> {
 
   protected:
-    std::type_info* type;
+    const void* type;
+
+    explicit PropertyType(const void* type) : type(type){}
 
   public:
     
     template<typename T>
-    bool typeOf(){
-      const std::type_info& typeInfo = *this->type;
-      return typeid(T) == typeInfo;
+    bool typeOf() const {
+      return this->type == &TypeTag<T>::id;
     }
 
+    /**
+     * Pointer to the value if it is a T, otherwise null
+    */
+    template<typename T>
+    const T* as() const;
+
     virtual ~PropertyType() = 0;
 };
 inline PropertyType::~PropertyType() {}
@@ -38,44 +56,60 @@ class PropertyDescriptor : public PropertyType {
 
   public:
 
-    explicit PropertyDescriptor(const T value){
-      this->type = const_cast<std::type_info*>(&typeid(value));
-      this->_value = value;
-    }
-
-    PropertyDescriptor(){}
+    explicit PropertyDescriptor(const T &value) : PropertyType(&TypeTag<T>::id), _value(value){}
+    explicit PropertyDescriptor(T &&value) : PropertyType(&TypeTag<T>::id), _value(std::move(value)){}
 
-    T value(){
+    const T& value() const {
       return this->_value;
     }
 };
 
+template<typename T>
+const T* PropertyType::as() const {
+  if(this->typeOf<T>()){
+    return &static_cast<const PropertyDescriptor<T>*>(this)->value();
+  }
+  return nullptr;
+}
+
 
 class PropertySet {
 
   protected:
-    std::map<std::string, Unique<PropertyType>> _properties;
+    typedef std::pair<const std::string, Unique<PropertyType>> Entry;
+    std::map<std::string, Unique<PropertyType>, std::less<std::string>, Postman::Memory::Allocator<Entry, Postman::Memory::PROPERTIES>> _properties;
 
   public:
+    typedef decltype(_properties)::const_iterator const_iterator;
 
     template<typename T>
-    void setProperty(std::string name, T value){
-      this->_properties[name].reset(new PropertyDescriptor<T>(value));
+    void setProperty(const std::string &name, T value){
+      this->_properties[name].reset(new PropertyDescriptor<T>(std::move(value)));
     }
 
+    /**
+     * Pointer to the property value, or null if name is not set as a T. Valid while the PropertySet is held
+    */
     template<typename T>
-    const T getProperty(const std::string name) const {
+    const T* findProperty(const std::string &name) const {
       auto iter = this->_properties.find(name);
       if(iter != this->_properties.end()){
-        if(iter->second->typeOf<T>()){
-          PropertyDescriptor<T> propertyDesc = dynamic_cast<PropertyDescriptor<T>&>(*iter->second);
-          return propertyDesc.value();
-        }
+        return iter->second->as<T>();
       }
-      return T();
+      return nullptr;
     }
 
-    bool hasProperty(const std::string name) const {
+    /**
+     * Reference to the property value, or to a default T if name is not set as a T. Valid while the PropertySet is held
+    */
+    template<typename T>
+    const T& getProperty(const std::string &name) const {
+      static const T empty = T();
+      const T* value = this->findProperty<T>(name);
+      return value ? *value : empty;
+    }
+
+    bool hasProperty(const std::string &name) const {
       auto iter = this->_properties.find(name);
       if(iter != this->_properties.end()){
         return true;
@@ -84,14 +118,16 @@ class PropertySet {
     }
 
     template<typename T>
-    bool hasProperty(const std::string name) const {
-      auto iter = this->_properties.find(name);
-      if(iter != this->_properties.end()){
-        if(iter->second->typeOf<T>()){
-          return true;
-        }
-      }
-      return false;
+    bool hasProperty(const std::string &name) const {
+      return this->findProperty<T>(name) != nullptr;
+    }
+
+    const_iterator begin() const {
+      return this->_properties.begin();
+    }
+
+    const_iterator end() const {
+      return this->_properties.end();
     }
 
     int size() const {
@@ -6,14 +6,11 @@
 
 #include "pico/multicore.h"
 #include "Node.h"
+#include "Lock.h"
 #include "defs.h"
 
 namespace Postman {
 
-  INTERNAL_NS
-    critical_section_t crit_sec;
-  END_INTERNAL
-
   class Queue {
     private:
       Node* _head = 0;
@@ -23,18 +20,22 @@ namespace Postman {
 
       uint8_t _tag = 0; // cycle id
 
+      Lock _lock;   // Per Queue, so Queues don't contend with each other
+
       void lock(){
-        critical_section_enter_blocking(&NS::crit_sec);
+        this->_lock.lock();
       }
 
       void unlock() {
-        critical_section_exit(&NS::crit_sec);
+        this->_lock.unlock();
       }
 
     public:
 
-      static void init(){
-        critical_section_init(&NS::crit_sec);
+      explicit Queue(const char* name) : _lock(name){}
+
+      void init(){
+        this->_lock.init();
       };
 
       Node* next(){
@@ -0,0 +1,171 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+namespace Postman {
+
+  /**
+   * Seeded, replayable sequence of core choices used to interleave the Dispatchers in simulation.
+   * The same seed always gives the same interleaving. A replay string of '0' & '1' choices is
+   * followed first, for hand written interleavings, then the seed takes over
+  */
+  class Schedule {
+
+    public:
+      explicit Schedule(const uint32_t seed = 1){
+        this->reset(seed);
+      }
+
+      void reset(const uint32_t seed){
+        this->_seed = seed ? seed : 1;    // xorshift has no zero state
+        this->_state = this->_seed;
+        this->_steps = 0;
+        this->_replay = nullptr;
+        this->_replayLength = 0;
+      }
+
+      /**
+       * Follow choices, which must outlive the Schedule, before continuing from the seed
+      */
+      void replay(const char* choices){
+        this->_replay = choices;
+        this->_replayLength = choices ? strlen(choices) : 0;
+      }
+
+      /**
+       * Core to take the next step, of cores
+      */
+      uint8_t next(const uint8_t cores = 2){
+        uint8_t core;
+        if(this->_steps < this->_replayLength){
+          core = this->_replay[this->_steps] - '0';
+        }
+        else {
+          core = this->random() % cores;
+        }
+        this->_steps++;
+        return core < cores ? core : 0;
+      }
+
+      uint32_t seed() const {
+        return this->_seed;
+      }
+
+      /**
+       * Number of choices made since reset()
+      */
+      uint32_t steps() const {
+        return this->_steps;
+      }
+
+    private:
+      uint32_t _seed;
+      uint32_t _state;
+      uint32_t _steps;
+
+      const char* _replay;
+      size_t _replayLength;
+
+      uint32_t random(){
+        uint32_t x = this->_state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return this->_state = x;
+      }
+  };
+
+
+  /**
+   * Virtual clock & turn taking of the simulated Dispatchers, in the order of a Schedule.
+   * Only the core holding the turn calls end() or idle(), so no state is written concurrently
+  */
+  class Lockstep {
+
+    public:
+      static constexpr uint8_t MAX_CORES = 2;
+      static constexpr uint64_t AWAKE = UINT64_MAX;    // No wake time, the core dispatched or hasn't idled yet
+
+      Schedule schedule;
+
+      explicit Lockstep(const uint32_t seed = 1) : schedule(seed){
+        this->start(0, 1);
+      }
+
+      /**
+       * Start the clock at now_us, with every core awake
+      */
+      void start(const uint64_t now_us, const uint8_t cores){
+        this->_clock = now_us;
+        this->_cores = cores < MAX_CORES ? cores : MAX_CORES;
+        for(uint8_t i = 0; i < MAX_CORES; i++){
+          this->_busy[i] = false;
+          this->_wake[i] = AWAKE;
+        }
+      }
+
+      uint64_t now() const {
+        return this->_clock;
+      }
+
+      /**
+       * Virtual time core will wake at, or AWAKE
+      */
+      uint64_t wake(const uint8_t core) const {
+        return this->_wake[core];
+      }
+
+      /**
+       * End core's step, advancing the clock by cost_us if it dispatched a Worker. Returns the core to take the next step
+      */
+      uint8_t end(const uint8_t core, const bool dispatched, const uint32_t cost_us){
+        if(dispatched){
+          this->_clock += cost_us;
+          this->_busy[core] = true;
+        }
+        return this->schedule.next(this->_cores);
+      }
+
+      /**
+       * End core's pass, after which it would idle for idle_us. Wake times are kept as absolute virtual times,
+       * as the clock moves on while other cores step. Once every core's last pass was idle the clock jumps
+       * to the earliest, or by 1us if it is already due. Returns the core to take the next step
+      */
+      uint8_t idle(const uint8_t core, const int64_t idle_us){
+        this->_wake[core] = this->_busy[core] ? AWAKE : this->_clock + (idle_us > 0 ? idle_us : 0);
+        this->_busy[core] = false;
+
+        uint64_t earliest = AWAKE;
+        bool asleep = true;
+        for(uint8_t i = 0; i < this->_cores; i++){
+          if(this->_wake[i] == AWAKE){
+            asleep = false;
+            break;
+          }
+          earliest = this->_wake[i] < earliest ? this->_wake[i] : earliest;
+        }
+
+        // Nothing can run until the next timeout, so jump straight to it
+        if(asleep){
+          this->_clock = earliest > this->_clock ? earliest : this->_clock + 1;
+          for(uint8_t i = 0; i < this->_cores; i++){
+            this->_wake[i] = AWAKE;
+          }
+        }
+        return this->schedule.next(this->_cores);
+      }
+
+    private:
+      uint64_t _clock;
+      uint8_t _cores;
+
+      bool _busy[MAX_CORES];      // Dispatched during the current pass
+      uint64_t _wake[MAX_CORES];
+  };
+
+}
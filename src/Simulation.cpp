@@ -0,0 +1,65 @@
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+
+#include "pico/multicore.h"
+
+#include "Simulation.h"
+#include "defs.h"
+
+
+namespace Postman {
+namespace Simulation {
+
+  INTERNAL_NS
+
+    /**
+     * Only the core holding the turn steps the Lockstep, and __dmb() publishes its state with the turn
+    */
+    Lockstep lockstep(SIMULATION_SEED);
+    volatile uint8_t turn = 0;
+
+    void pass(const uint8_t next){
+      __dmb();
+      NS::turn = next;
+    }
+
+  END_INTERNAL
+
+  void seed(const uint32_t seed, const char* replay){
+    NS::lockstep.schedule.reset(seed);
+    NS::lockstep.schedule.replay(replay);
+    NS::turn = 0;
+  }
+
+  void init(){
+    NS::lockstep.start(to_us_since_boot(get_absolute_time()), DISPATCHER_MULTICORE ? 2 : 1);
+  }
+
+  absolute_time_t now(){
+    return from_us_since_boot(NS::lockstep.now());
+  }
+
+  uint32_t steps(){
+    return NS::lockstep.schedule.steps();
+  }
+
+  void begin(){
+    uint8_t core = get_core_num();
+    while(NS::turn != core){
+      tight_loop_contents();
+    }
+    __dmb();
+  }
+
+  void end(const bool dispatched){
+    NS::pass(NS::lockstep.end(get_core_num(), dispatched, SIMULATION_DISPATCH_COST));
+  }
+
+  void idle(const int64_t idle_us){
+    NS::pass(NS::lockstep.idle(get_core_num(), idle_us));
+  }
+
+}}
@@ -0,0 +1,52 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include "pico/time.h"
+
+#include "Schedule.h"
+#include "defs.h"
+
+namespace Postman {
+namespace Simulation {
+
+  /**
+   * Choose the Schedule before Postman::start(). A replay string of '0' & '1' core choices,
+   * which must outlive the simulation, is followed before the seed
+  */
+  void seed(const uint32_t seed, const char* replay = nullptr);
+
+  /**
+   * Start the virtual clock at the current time
+  */
+  void init();
+
+  /**
+   * Virtual time
+  */
+  absolute_time_t now();
+
+  /**
+   * Number of Dispatcher steps taken, with seed() identifies a point in a run to reproduce
+  */
+  uint32_t steps();
+
+  /**
+   * Wait for the current core's turn to take a step
+  */
+  void begin();
+
+  /**
+   * End the current core's step, advancing the clock if it dispatched a Worker, and pass the turn
+  */
+  void end(const bool dispatched);
+
+  /**
+   * End the current core's pass. Once every core's last pass was idle the clock jumps to the
+   * earliest wake time, instead of the Dispatchers idling in real time
+  */
+  void idle(const int64_t idle_us);
+
+}}
@@ -0,0 +1,49 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include <stddef.h>
+
+namespace Postman {
+
+  /**
+   * Non-owning view of a contiguous sequence of T
+  */
+  template<class T>
+  class Span {
+
+    private:
+      T* _data;
+      size_t _size;
+
+    public:
+      Span(T* data = nullptr, size_t size = 0) : _data(data), _size(size){}
+
+      T* data() const {
+        return this->_data;
+      }
+
+      size_t size() const {
+        return this->_size;
+      }
+
+      bool empty() const {
+        return this->_size == 0;
+      }
+
+      T& operator[](size_t index) const {
+        return this->_data[index];
+      }
+
+      T* begin() const {
+        return this->_data;
+      }
+
+      T* end() const {
+        return this->_data + this->_size;
+      }
+  };
+
+};
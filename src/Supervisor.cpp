@@ -8,8 +8,14 @@
 
 #include "Postman.h"
 #include "Supervisor.h"
+#include "Clock.h"
 #include "Dispatcher.h"
+#include "Fork.h"
+#include "Memory.h"
 #include "Queue.h"
+#include "Simulation.h"
+#include "Trace.h"
+#include "WorkQueue.h"
 #include "Worker.h"
 #include "defs.h"
 
@@ -20,10 +26,21 @@ namespace Supervisor {
   INTERNAL_NS
 
     Dispatcher* dispatcher[2];
+    Worker* pool;
 
-    Postman::Queue free;
-    Postman::Queue ready;
-    Postman::Queue zombies;
+    // Kernel structures are placed statically, constructed during start up
+    uint8_t __attribute__((aligned(alignof(Worker)))) workers[sizeof(Worker) * WORKER_POOL_SIZE];
+    uint8_t __attribute__((aligned(alignof(Dispatcher)))) dispatchers[sizeof(Dispatcher) * 2];
+
+    /**
+     * Bumped by anything that may make a Worker runnable. The M0+ has no atomic increment, so each core
+     * only bumps its own counter, with interrupts disabled, and a Dispatcher's snapshot compares their sum
+    */
+    volatile uint32_t epoch[2] = {0, 0};
+
+    Postman::Queue free("free");
+    Postman::Queue ready("ready");
+    Postman::Queue zombies("zombies");
     Shared<Endpoint> gc_endpoint;
 
     /**
@@ -39,13 +56,119 @@ namespace Supervisor {
         printf("Core: %i :: GC Signals: %i  Zombies: %i\n", get_core_num(), signals, NS::zombies.length());
         while ((zombie = (Worker*) NS::zombies.next())) {
           NS::zombies.remove(zombie);
-          zombie->endpoint = nullptr;
           Endpoint::release(zombie->endpoint);
+          zombie->endpoint = nullptr;
           NS::free.push(zombie);
         }
       }
     }
 
+    /**
+     * This Worker is created during the Supervisor start-up when STATS_PERIOD_MS is set.
+     * It publishes kernel metrics through the normal publish/fetch path. Worker states are
+     * sampled without locking, so counts are approximate
+    */
+    void stats(){
+      uint64_t busy[2] = {0, 0};
+      uint64_t idle[2] = {0, 0};
+      uint32_t passes[2] = {0, 0};
+      absolute_time_t last = Clock::now();    // The Dispatchers' busy & idle times are in Clock time too
+
+      struct Sample {
+        Shared<Endpoint> endpoints[STATS_MAX_ENDPOINTS];
+        uint8_t count;
+      } sample;
+
+      while(1){
+        Postman::sleep(STATS_PERIOD_MS);
+
+        absolute_time_t now = Clock::now();
+        uint64_t period = absolute_time_diff_us(last, now);
+        last = now;
+
+        Shared<Message> message = Postman::compose();
+        message->setProperty<uint32_t>("period", period);
+
+        for(uint8_t core = 0; core < 2; core++){
+          Dispatcher* dispatcher = NS::dispatcher[core];
+          if(!dispatcher || !period){
+            continue;
+          }
+          uint64_t coreBusy = dispatcher->busy;
+          uint64_t coreIdle = dispatcher->idle;
+          uint32_t corePasses = dispatcher->passes;
+
+          std::string prefix = "core" + std::to_string(core) + ".";
+          message->setProperty<uint32_t>(prefix + "utilisation", (coreBusy - busy[core]) * 100 / period);
+          message->setProperty<uint32_t>(prefix + "idle", coreIdle - idle[core]);
+          message->setProperty<uint32_t>(prefix + "passes", (uint64_t) (corePasses - passes[core]) * 1000000 / period);
+
+          busy[core] = coreBusy;
+          idle[core] = coreIdle;
+          passes[core] = corePasses;
+        }
+
+        uint32_t ready = 0, blocked = 0, sleeping = 0;
+        for(int i = 0; i < WORKER_POOL_SIZE; i++){
+          Worker* worker = &NS::pool[i];
+          if(worker->isZombie() || !worker->endpoint.get()){    // Free or awaiting the GC
+            continue;
+          }
+          if(worker->isBlocked()){
+            blocked++;
+          }
+          else if(worker->hasTimeout()){
+            sleeping++;
+          }
+          else {
+            ready++;
+          }
+        }
+        message->setProperty<uint32_t>("workers.ready", ready);
+        message->setProperty<uint32_t>("workers.blocked", blocked);
+        message->setProperty<uint32_t>("workers.sleeping", sleeping);
+        message->setProperty<uint32_t>("workers.free", NS::free.length());
+        message->setProperty<uint32_t>("messages.free", Message::available());
+
+        for(uint8_t i = 0; MEMORY_ACCOUNTING && i < Memory::SUBSYSTEMS; i++){
+          Memory::Usage usage = Memory::usage((Memory::Subsystem) i);
+          std::string prefix = std::string("memory.") + Memory::name((Memory::Subsystem) i) + ".";
+          message->setProperty<int>(prefix + "current", usage.current);
+          message->setProperty<int>(prefix + "peak", usage.peak);
+          message->setProperty<uint32_t>(prefix + "allocations", usage.allocations);
+        }
+        for(uint32_t block = 16; MEMORY_POOLS && block <= 128; block <<= 1){
+          message->setProperty<uint32_t>("memory.pool" + std::to_string(block) + ".free", Memory::available(block));
+        }
+
+        // Copy out under the registry Lock without allocating, then build the properties
+        sample.count = 0;
+        Endpoint::each("/**", [](Endpoint &endpoint, void* data){
+          Sample* sample = static_cast<Sample*>(data);
+          if(sample->count < STATS_MAX_ENDPOINTS){
+            sample->endpoints[sample->count++] = endpoint.shared_from_this();
+          }
+        }, &sample);
+        for(uint8_t i = 0; i < sample.count; i++){
+          message->setProperty<uint64_t>("cpu:" + sample.endpoints[i]->uri, sample.endpoints[i]->cpu);
+          if(MEMORY_ACCOUNTING){
+            message->setProperty<uint32_t>("allocated:" + sample.endpoints[i]->uri, sample.endpoints[i]->allocated);
+          }
+          const Shared<WorkQueue> &queue = sample.endpoints[i]->queue;
+          if(queue && queue->key == sample.endpoints[i]->key){
+            message->setProperty<uint32_t>("depth:" + sample.endpoints[i]->uri, queue->depth());
+            message->setProperty<uint32_t>("posted:" + sample.endpoints[i]->uri, queue->posted);
+          }
+          else if(queue){
+            message->setProperty<uint32_t>("jobs:" + sample.endpoints[i]->uri, sample.endpoints[i]->jobs);
+          }
+          sample.endpoints[i].reset();
+        }
+
+        Postman::publish(message);
+      }
+    }
+
   END_INTERNAL
 
   bool exec(Weak<Endpoint> endpoint, const Endpoint::Handler &handler){
@@ -60,6 +183,7 @@ namespace Supervisor {
     if(target && worker){
       worker->assign(target, handler);
       NS::ready.push(worker);
+      Supervisor::wake();
       return true;
     }
     return false;
@@ -98,6 +222,33 @@ namespace Supervisor {
     return NS::dispatcher[get_core_num()];
   }
 
+  void wake(){
+    int interrupts = save_and_disable_interrupts();
+      uint8_t core = get_core_num();
+      NS::epoch[core] = NS::epoch[core] + 1;
+    restore_interrupts(interrupts);
+  }
+
+  uint32_t epoch(){
+    return NS::epoch[0] + NS::epoch[1];
+  }
+
+  bool alone(const absolute_time_t until){
+    if(!DISPATCHER_FAST_YIELD || SIMULATION){
+      return false;
+    }
+    // Interrupts off so the Worker can't be moved to the other core mid check
+    int interrupts = save_and_disable_interrupts();
+      Dispatcher* dispatcher = NS::dispatcher[get_core_num()];
+      bool alone = dispatcher && dispatcher->alone(until);
+    restore_interrupts(interrupts);
+    return alone;
+  }
+
+  Dispatcher* dispatcher(const uint8_t core){
+    return core < 2 ? NS::dispatcher[core] : nullptr;
+  }
+
   Postman::Worker* next(){
     /**
      * Each queue "cycles"
@@ -137,43 +288,104 @@ namespace Supervisor {
     */
   }
 
+  Postman::Worker* earliest(){
+    /**
+     * Find the released periodic Worker with the earliest absolute deadline whose job hasn't yet been dispatched.
+     * The pool is scanned on flags & timestamps alone, only the chosen Worker is bound and re-checked.
+     * The Worker is returned bound to the current core, or null if none are runnable
+    */
+    Postman::Worker* earliest = 0;
+
+    for (int i = 0; i < WORKER_POOL_SIZE; i++) {
+      Postman::Worker* worker = &NS::pool[i];
+      if(!worker->pending || worker->isZombie() || worker->isBlocked()){
+        continue;
+      }
+      if(worker->hasTimeout() && !Clock::reached(worker->timeout)){
+        continue;   // Not released yet
+      }
+      if(earliest && absolute_time_diff_us(earliest->deadline, worker->deadline) >= 0){
+        continue;
+      }
+      earliest = worker;
+    }
+
+    if(earliest && earliest->bind()){
+      if(earliest->pending && !earliest->isSleeping() && !earliest->isBlocking()){
+        return earliest;    // pending is cleared as it is dispatched
+      }
+      earliest->release();
+    }
+    return 0;
+  }
+
   void launch() {
     NS::dispatcher[get_core_num()]->begin();
   }
 
-  void start(const std::string &appUri, const Endpoint::Handler &appHandler){
+  void start(const std::string &appUri, const Endpoint::Handler &appHandler, const Endpoint::Declaration* topology, const uint8_t count){
     if(get_core_num() != 0){
       return;
     }
 
-    Queue::init();
-    NS::free = Queue();
-    NS::ready = Queue();
-    NS::zombies = Queue();
+    if(MEMORY_ACCOUNTING || MEMORY_POOLS){
+      Memory::init();
+    }
 
-    Worker* WorkerPool = new Worker[WORKER_POOL_SIZE];
+    NS::free.init();
+    NS::ready.init();
+    NS::zombies.init();
+
+    NS::pool = reinterpret_cast<Worker*>(NS::workers);
     for (int i = 0; i < WORKER_POOL_SIZE; i++) {
-      NS::free.push(&WorkerPool[i]);
+      new (&NS::pool[i]) Worker();
+      NS::free.push(&NS::pool[i]);
     }
 
     Endpoint::init();
+    WorkQueue::init();
     Message::init();
+    Buffer::init();
 
     // Create & add the GC endpoint
     Weak<Endpoint> gc = Endpoint::create("/postman/gc", Endpoint::Empty);
     NS::gc_endpoint = gc.lock();
     Supervisor::exec(gc, NS::garbage_collector);
 
+    if(STATS_PERIOD_MS){
+      Weak<Endpoint> stats = Endpoint::create("/postman/stats", Endpoint::Empty);
+      Supervisor::exec(stats, NS::stats);
+    }
+
+    Fork::init();
+
     // Create & add the main app endpoint
     Weak<Endpoint> app = Endpoint::create(appUri, Endpoint::Empty);
     Supervisor::exec(app, appHandler);  
 
+    // Open the static topology, owned by the app endpoint
+    for(uint8_t i = 0; i < count; i++){
+      const Endpoint::Declaration &declared = topology[i];
+      Weak<Endpoint> endpoint = Endpoint::create(declared.uri, app, declared.history, declared.quantum);
+      if(Endpoint::isEmpty(endpoint) || !Supervisor::exec(endpoint, declared.handler)){
+        printf("Postman :: Failed to open %s\n", declared.uri);
+      }
+    }
+
     Dispatcher::init();
 
-    NS::dispatcher[0] = new Dispatcher();
+    if(SIMULATION){
+      Simulation::init();
+    }
+    if(TRACE){
+      Trace::init();
+    }
+
+    Dispatcher* dispatchers = reinterpret_cast<Dispatcher*>(NS::dispatchers);
+    NS::dispatcher[0] = new (&dispatchers[0]) Dispatcher();
 
     if(DISPATCHER_MULTICORE){
-      NS::dispatcher[1] = new Dispatcher();
+      NS::dispatcher[1] = new (&dispatchers[1]) Dispatcher();
       multicore_launch_core1(Supervisor::launch);
     }
     Supervisor::launch();
@@ -11,14 +11,28 @@ namespace Postman {
 
   namespace Supervisor {
 
-    void start(const std::string &appUri, const Endpoint::Handler &appHandler);
+    void start(const std::string &appUri, const Endpoint::Handler &appHandler, const Endpoint::Declaration* topology, const uint8_t count);
 
     bool exec(Weak<Endpoint> endpoint, const Endpoint::Handler &handler);
     void halt(Worker* worker);
 
     Worker* self();
     Dispatcher* dispatcher();
+    Dispatcher* dispatcher(const uint8_t core);   // Null if core isn't dispatching
+
+    /**
+     * Note that a Worker may have become runnable, ending any Dispatcher's fast path, see alone()
+    */
+    void wake();
+    uint32_t epoch();
+
+    /**
+     * Whether no other Worker can become runnable on the current core before until, within the current slice.
+     * The current Worker may then carry on rather than yield
+    */
+    bool alone(const absolute_time_t until);
 
     Worker* next();
+    Worker* earliest();
 
 }};
@@ -0,0 +1,289 @@
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+
+#include "Trace.h"
+#include "Clock.h"
+#include "Dispatcher.h"
+#include "Lock.h"
+#include "Supervisor.h"
+#include "Worker.h"
+#include "defs.h"
+
+
+namespace Postman {
+namespace Trace {
+
+  INTERNAL_NS
+
+    Postman::Lock lock("trace");
+
+    // Capture
+    Unique<Wire::Encoder> encoder;
+    volatile bool capturing = false;
+    volatile uint32_t traced[TRACE_MAX_ENDPOINTS];
+    volatile uint8_t tracedCount = 0;
+    uint64_t last = 0;
+    const PropertySet empty;
+
+    // Publish to fetch latency
+    struct Latency {
+      uint32_t key;
+      Weak<const Endpoint> endpoint;
+      Histogram histogram;
+    };
+    Latency latency[TRACE_MAX_ENDPOINTS];
+    uint8_t latencyCount = 0;
+
+    uint64_t now(){
+      return to_us_since_boot(Clock::now());
+    }
+
+    int16_t find(const uint32_t key){
+      for(uint8_t i = 0; i < NS::tracedCount; i++){
+        if(NS::traced[i] == key){
+          return i;
+        }
+      }
+      return -1;
+    }
+
+    /**
+     * Add endpoint to the trace, unless it is already defined or the trace is full.
+     * The DEFINE properties allocate, so are built outside the Lock & never on a hook's path
+     * Handler only
+    */
+    void define(const Endpoint &endpoint){
+      PropertySet properties;
+      properties.setProperty<std::string>("uri", endpoint.uri);
+
+      NS::lock.lock();
+      if(NS::capturing && NS::find(endpoint.key) < 0 && NS::tracedCount < TRACE_MAX_ENDPOINTS){
+        NS::encoder->encode((NS::tracedCount << 2) | Event::DEFINE, properties);
+        NS::traced[NS::tracedCount++] = endpoint.key;
+      }
+      NS::lock.unlock();
+    }
+
+    void time(){
+      uint64_t now = NS::now();
+      uint64_t elapsed = now - NS::last;
+      while(elapsed){
+        uint32_t step = elapsed > 0x3fffffff ? 0x3fffffff : elapsed;
+        NS::encoder->encode((step << 2) | Event::TIME, NS::empty);
+        elapsed -= step;
+      }
+      NS::last = now;
+    }
+
+    /**
+     * Encode event, if endpoint was defined. Never allocates, so it is safe from handler mode
+    */
+    void record(const Event event, const Endpoint &endpoint, const Message* message){
+      NS::lock.lock();
+      if(NS::capturing){
+        int16_t index = NS::find(endpoint.key);
+        if(index >= 0){
+          NS::time();
+          if(message){
+            NS::encoder->encode((index << 2) | event, *message, message->payload());
+          }
+          else {
+            NS::encoder->encode((index << 2) | event, NS::empty);
+          }
+        }
+      }
+      NS::lock.unlock();
+    }
+
+  END_INTERNAL
+
+  void init(){
+    NS::lock.init();
+  }
+
+  void capture(const Wire::Sink &sink, void* context){
+    Unique<Wire::Encoder> encoder(new Wire::Encoder(sink, context));
+    NS::lock.lock();
+      NS::encoder.swap(encoder);
+      NS::tracedCount = 0;
+      NS::last = NS::now();
+      NS::capturing = true;
+    NS::lock.unlock();
+    // Any previous Encoder is freed outside the Lock
+
+    // Endpoints created from here on are defined by created()
+    std::vector<Shared<Endpoint>> endpoints;
+    Endpoint::match("/**", endpoints);
+    for(Shared<Endpoint> &endpoint : endpoints){
+      NS::define(*endpoint);
+    }
+  }
+
+  void stop(){
+    NS::lock.lock();
+      NS::capturing = false;
+    NS::lock.unlock();
+  }
+
+  void created(const Endpoint &endpoint){
+    if(NS::capturing){
+      NS::define(endpoint);
+    }
+  }
+
+  void published(const Endpoint &endpoint, const Message &message){
+    if(NS::capturing){
+      NS::record(Event::PUBLISH, endpoint, &message);
+    }
+  }
+
+  void signalled(const Endpoint &endpoint){
+    if(NS::capturing){
+      NS::record(Event::NOTIFY, endpoint, nullptr);
+    }
+  }
+
+  void fetched(const Endpoint &endpoint, const Message &message){
+    if(!message.published){
+      return;
+    }
+    uint64_t sample = NS::now() - message.published;
+    Weak<const Endpoint> weak = endpoint.shared_from_this();
+
+    NS::lock.lock();
+      uint8_t i = 0;
+      while(i < NS::latencyCount && NS::latency[i].key != endpoint.key){
+        i++;
+      }
+      if(i == NS::latencyCount && NS::latencyCount < TRACE_MAX_ENDPOINTS){
+        NS::latency[i].key = endpoint.key;
+        NS::latency[i].endpoint.swap(weak);
+        NS::latencyCount++;
+      }
+      if(i < NS::latencyCount){
+        NS::latency[i].histogram.add(sample > UINT32_MAX ? UINT32_MAX : sample);
+      }
+    NS::lock.unlock();
+    // weak is released outside the Lock
+  }
+
+  void report(){
+    for(uint8_t i = 0; i < NS::latencyCount; i++){
+      NS::lock.lock();
+        Histogram histogram = NS::latency[i].histogram;
+      NS::lock.unlock();
+      Shared<const Endpoint> endpoint = NS::latency[i].endpoint.lock();
+      histogram.print("publish_fetch", endpoint ? endpoint->uri.c_str() : "", "us");
+    }
+  }
+
+  void reset(){
+    NS::lock.lock();
+      for(uint8_t i = 0; i < NS::latencyCount; i++){
+        NS::latency[i].histogram = Histogram();
+      }
+    NS::lock.unlock();
+  }
+
+
+  Player::Player(const Span<const uint8_t> &trace, const uint16_t speed, const std::string &prefix) :
+    _trace(trace),
+    _speed(speed),
+    _prefix(prefix),
+    _decoder(Player::onField, Player::onFrame, this){}
+
+  Player::~Player(){
+    for(auto &replayed : this->_endpoints){
+      if(replayed.owned){
+        Endpoint::release(replayed.endpoint);
+      }
+    }
+  }
+
+  bool Player::run(){
+    uint64_t busy[2] = {0, 0};
+    for(uint8_t core = 0; core < 2; core++){
+      Dispatcher* dispatcher = Supervisor::dispatcher(core);
+      busy[core] = dispatcher ? dispatcher->busy : 0;
+    }
+    Trace::reset();
+
+    this->_start = NS::now();
+    this->_elapsed = 0;
+    this->_lag = Histogram();
+    bool ok = this->_decoder.feed(this->_trace.data(), this->_trace.size());
+    uint64_t wall = NS::now() - this->_start;
+
+    this->_lag.print("replay_lag", this->_prefix.c_str(), "us");
+    for(uint8_t core = 0; core < 2; core++){
+      Dispatcher* dispatcher = Supervisor::dispatcher(core);
+      if(dispatcher){
+        uint64_t used = dispatcher->busy - busy[core];
+        printf("{\"benchmark\":\"utilisation\",\"core\":%u,\"busy\":%llu,\"wall\":%llu,\"percent\":%lu}\n",
+          core, used, wall, (unsigned long) (wall ? used * 100 / wall : 0));
+      }
+    }
+    Trace::report();
+    return ok;
+  }
+
+  void Player::onField(const Wire::Field &field, void* context){
+    static_cast<Player*>(context)->field(field);
+  }
+
+  void Player::onFrame(uint32_t id, void* context){
+    static_cast<Player*>(context)->frame((Event) (id & 3), id >> 2);
+  }
+
+  void Player::field(const Wire::Field &field){
+    this->_collector.field(field);
+  }
+
+  void Player::frame(const Event event, const uint32_t argument){
+    Wire::Collected frame = this->_collector.take();
+    Shared<Message> &message = frame.message;
+
+    if(event == Event::TIME){
+      this->_elapsed += argument;
+      if(this->_speed){
+        absolute_time_t due = from_us_since_boot(this->_start + this->_elapsed / this->_speed);
+        Supervisor::self()->sleepUntil(due);
+        this->_lag.add(absolute_time_diff_us(due, Clock::now()));
+      }
+      return;
+    }
+
+    if(event == Event::DEFINE){
+      if(!message || !message->hasProperty<std::string>("uri")){
+        return;
+      }
+      std::string uri = this->_prefix + message->getProperty<std::string>("uri");
+      Replayed replayed = { Endpoint::get(uri), false };
+      if(!replayed.endpoint){
+        replayed.endpoint = Endpoint::create(uri, Supervisor::self()->endpoint, 1).lock();
+        replayed.owned = true;
+      }
+      if(argument >= this->_endpoints.size()){
+        this->_endpoints.resize(argument + 1);
+      }
+      this->_endpoints[argument] = replayed;
+      return;
+    }
+
+    if(argument >= this->_endpoints.size() || !this->_endpoints[argument].endpoint){
+      return;
+    }
+    Replayed &replayed = this->_endpoints[argument];
+
+    if(event == Event::PUBLISH && replayed.owned){
+      replayed.endpoint->publish(frame.publishable(replayed.endpoint));
+    }
+    else if(event == Event::NOTIFY){
+      replayed.endpoint->signal();
+    }
+  }
+
+}}
@@ -0,0 +1,113 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include <string>
+#include <vector>
+
+#include "Endpoint.h"
+#include "Histogram.h"
+#include "Message.h"
+#include "Span.h"
+#include "Wire.h"
+#include "defs.h"
+#include "pointers.h"
+
+/**
+ * Capture of live publish & notify traffic, and replay of a captured trace as a load generator.
+ *
+ * A trace is a stream of Wire frames whose id holds the event in the low 2 bits:
+ *  DEFINE    id >> 2 is the Endpoint's index in the trace, field "uri"
+ *  TIME      id >> 2 us have passed since the previous event
+ *  PUBLISH   id >> 2 is the Endpoint index, fields & payload are the Message's
+ *  NOTIFY    id >> 2 is the Endpoint index
+*/
+
+namespace Postman {
+namespace Trace {
+
+  enum Event : uint8_t {
+    DEFINE,
+    TIME,
+    PUBLISH,
+    NOTIFY,
+  };
+
+  void init();
+
+  /**
+   * Record every publish() & successful signal to sink until stop(). The sink is called with interrupts
+   * disabled, possibly in handler mode, so should only copy, e.g. into RAM. Open Endpoints are defined when
+   * the capture starts and new ones as they are created, so the publish & notify hooks never allocate.
+   * Only the first TRACE_MAX_ENDPOINTS Endpoints are traced
+   * Requires TRACE, Handler only
+  */
+  void capture(const Wire::Sink &sink, void* context = nullptr);
+  void stop();
+
+  /**
+   * Print publish to fetch latency per Endpoint as JSON lines, and restart measuring
+   * Requires TRACE
+  */
+  void report();
+  void reset();
+
+  // Kernel hooks, while TRACE
+  void created(const Endpoint &endpoint);
+  void published(const Endpoint &endpoint, const Message &message);
+  void signalled(const Endpoint &endpoint);
+  void fetched(const Endpoint &endpoint, const Message &message);
+
+
+  /**
+   * Replays a captured trace against the running kernel. Each traced URI is opened as prefix + URI and
+   * the recorded Messages are published, and notifies signalled, at speed times the recorded rate
+  */
+  class Player {
+
+    public:
+      /**
+       * speed 0 replays as fast as possible. trace must outlive the Player
+      */
+      Player(const Span<const uint8_t> &trace, const uint16_t speed = 1, const std::string &prefix = "");
+      ~Player();
+
+      /**
+       * Replay the whole trace, then print how late events were replayed, Dispatcher utilisation and
+       * publish to fetch latency as JSON lines. Returns false if the trace is corrupt
+       * Handler only
+      */
+      bool run();
+
+    private:
+      /**
+       * Endpoints open elsewhere are only signalled, publishing would make a second writer
+      */
+      struct Replayed {
+        Shared<Endpoint> endpoint;
+        bool owned;
+      };
+
+      const Span<const uint8_t> _trace;
+      const uint16_t _speed;
+      const std::string _prefix;
+
+      Wire::Decoder _decoder;
+      std::vector<Replayed> _endpoints;
+
+      uint64_t _start = 0;      // us
+      uint64_t _elapsed = 0;    // Trace time, us
+      Histogram _lag;
+
+      Wire::Collector _collector;   // Frame being decoded
+
+      static void onField(const Wire::Field &field, void* context);
+      static void onFrame(uint32_t id, void* context);
+
+      void field(const Wire::Field &field);
+      void frame(const Event event, const uint32_t argument);
+  };
+
+}}
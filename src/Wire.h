@@ -0,0 +1,791 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+#include "Buffer.h"
+#include "Message.h"
+#include "Properties.h"
+#include "Span.h"
+#include "defs.h"
+
+/**
+ * Compact, schema-less binary encoding of PropertySets & Messages for streaming off chip.
+ * Portable, header only and heap free so the same Decoder can be built for the host.
+ *
+ * All integers are LEB128 varints, floats & doubles are little endian.
+ *
+ *  frame  := varint(body length) body
+ *  body   := u8 WIRE_VERSION, varint id, varint field count, field*
+ *  field  := varint key, u8 type, value
+ *  type   := (width << 4) | Type       width is log2 of an integer's size in bytes, 0 for other types
+ *  key    := (index << 1) | 1          an interned key
+ *          | (length << 1), bytes      a literal key, interned in order while the table has room
+ *  value  := varint                    UNSIGNED, SIGNED (zigzag)
+ *          | 4 | 8 bytes               FLOAT | DOUBLE
+ *          | varint length, bytes      STRING | BYTES
+ *          | nothing                   BOOLEAN_FALSE | BOOLEAN_TRUE
+ *
+ * A Message's binary payload is encoded as a final BYTES field with an empty key.
+ * Interned keys persist across frames, so an Encoder and Decoder pair must see the same stream from reset().
+ * Literal keys are only interned once their frame is complete, so an aborted frame leaves both tables unchanged
+*/
+
+namespace Postman {
+namespace Wire {
+
+  enum class Type : uint8_t {
+    BOOLEAN_FALSE,
+    BOOLEAN_TRUE,
+    UNSIGNED,
+    SIGNED,
+    FLOAT,
+    DOUBLE,
+    STRING,
+    BYTES,
+  };
+
+  struct Field {
+    const char* key;        // NUL terminated
+    Type type;
+    uint8_t width;          // Size in bytes of an UNSIGNED or SIGNED value, 0 otherwise
+    union {
+      bool b;
+      uint64_t u;
+      int64_t i;
+      float f;
+      double d;
+    } value;
+
+    /**
+     * STRING & BYTES values longer than WIRE_MAX_VALUE are delivered as consecutive chunks
+    */
+    const uint8_t* data;
+    size_t length;          // Of this chunk
+    size_t offset;          // Of this chunk within the value
+    size_t total;           // Length of the value
+  };
+
+  /**
+   * Encoder output. Returns false to abort the frame
+  */
+  typedef bool (*Sink)(const uint8_t* data, size_t length, void* context);
+
+  typedef void (*FieldCallback)(const Field &field, void* context);
+  typedef void (*FrameCallback)(uint32_t id, void* context);
+
+  inline size_t varintSize(uint64_t value){
+    size_t size = 1;
+    while(value >= 0x80){
+      value >>= 7;
+      size++;
+    }
+    return size;
+  }
+
+  inline uint64_t zigzag(int64_t value){
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+  }
+
+  inline int64_t unzigzag(uint64_t value){
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+  }
+
+  /**
+   * Set a decoded field as a property, gathering STRING chunks in scratch until the value is complete.
+   * Integers keep their encoded width & signedness, as uint8_t, uint16_t, uint32_t, uint64_t, int8_t,
+   * int16_t, int or int64_t. A property set as another type of the same width, such as size_t or long,
+   * must be read back as this type. Returns false for BYTES, which have no property type
+  */
+  inline bool assign(PropertySet &properties, const Field &field, std::string &scratch){
+    switch(field.type){
+      case Type::BOOLEAN_FALSE:
+      case Type::BOOLEAN_TRUE:
+        properties.setProperty<bool>(field.key, field.value.b);
+        break;
+      case Type::UNSIGNED:
+        switch(field.width){
+          case 1: properties.setProperty<uint8_t>(field.key, field.value.u); break;
+          case 2: properties.setProperty<uint16_t>(field.key, field.value.u); break;
+          case 4: properties.setProperty<uint32_t>(field.key, field.value.u); break;
+          default: properties.setProperty<uint64_t>(field.key, field.value.u);
+        }
+        break;
+      case Type::SIGNED:
+        switch(field.width){
+          case 1: properties.setProperty<int8_t>(field.key, field.value.i); break;
+          case 2: properties.setProperty<int16_t>(field.key, field.value.i); break;
+          case 4: properties.setProperty<int>(field.key, field.value.i); break;
+          default: properties.setProperty<int64_t>(field.key, field.value.i);
+        }
+        break;
+      case Type::FLOAT:
+        properties.setProperty<float>(field.key, field.value.f);
+        break;
+      case Type::DOUBLE:
+        properties.setProperty<double>(field.key, field.value.d);
+        break;
+      case Type::STRING:
+        if(field.offset == 0){
+          scratch.clear();
+        }
+        scratch.append((const char*) field.data, field.length);
+        if(field.offset + field.length == field.total){
+          properties.setProperty<std::string>(field.key, scratch);
+        }
+        break;
+      default:
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * A decoded frame, its properties collected into a Message & its payload into a pooled Buffer.
+   * Either is null if the frame had none
+  */
+  struct Collected {
+    Shared<Message> message;
+    Shared<Buffer> payload;
+
+    /**
+     * The Message to publish on behalf of origin, created if the frame had no properties, with the payload attached
+    */
+    Shared<Message> publishable(const Shared<Endpoint> &origin){
+      if(!this->message){
+        this->message = Message::create(origin);
+      }
+      this->message->origin = origin;
+      if(this->payload){
+        this->message->attach(this->payload);
+      }
+      return this->message;
+    }
+  };
+
+  /**
+   * Collects a Decoder's fields, frame by frame. Payloads larger than a Buffer, or received while the pool
+   * is exhausted, are dropped. Requires the Message bank & Buffer pool, so is device only
+  */
+  class Collector {
+
+    public:
+      void field(const Field &field){
+        if(!this->_frame.message){
+          this->_frame.message = Message::create(nullptr);
+        }
+        if(assign(*this->_frame.message, field, this->_string) || *field.key){
+          return;   // Only the payload is encoded as BYTES
+        }
+
+        if(field.offset == 0){
+          this->_frame.payload = Buffer::create();
+        }
+        Shared<Buffer> &payload = this->_frame.payload;
+        if(payload && field.offset + field.length <= payload->capacity()){
+          memcpy(payload->data() + field.offset, field.data, field.length);
+          payload->length = field.offset + field.length;
+        }
+        else {
+          payload = nullptr;
+        }
+      }
+
+      /**
+       * The frame collected so far, starting the next
+      */
+      Collected take(){
+        Collected frame;
+        frame.message.swap(this->_frame.message);
+        frame.payload.swap(this->_frame.payload);
+        return frame;
+      }
+
+    private:
+      Collected _frame;
+      std::string _string;    // STRING chunks
+  };
+
+
+  /**
+   * Fixed table of interned keys, kept identically by an Encoder and its Decoder.
+   * Keys added during a frame are staged after count, and only found once the frame is commit()ed
+  */
+  struct Keys {
+    char keys[WIRE_MAX_KEYS][WIRE_MAX_KEY_LENGTH + 1];
+    uint8_t count = 0;
+    uint8_t staged = 0;
+
+    int16_t find(const char* key, size_t length) const {
+      for(uint8_t i = 0; i < this->count; i++){
+        if(strlen(this->keys[i]) == length && memcmp(this->keys[i], key, length) == 0){
+          return i;
+        }
+      }
+      return -1;
+    }
+
+    const char* add(const char* key, size_t length){
+      if(this->staged >= WIRE_MAX_KEYS){
+        return nullptr;
+      }
+      char* interned = this->keys[this->staged++];
+      memcpy(interned, key, length);
+      interned[length] = '\0';
+      return interned;
+    }
+
+    void commit(){
+      this->count = this->staged;
+    }
+
+    void rollback(){
+      this->staged = this->count;
+    }
+
+    void clear(){
+      this->count = this->staged = 0;
+    }
+  };
+
+
+  class Encoder {
+
+    public:
+      Encoder(const Sink &sink, void* context = nullptr) : _sink(sink), _context(context){}
+
+      /**
+       * Encode properties, and an optional binary payload, as one frame.
+       * Properties of unsupported types, or with keys longer than WIRE_MAX_KEY_LENGTH, are skipped.
+       * Returns false if the sink aborted
+      */
+      bool encode(const uint32_t id, const PropertySet &properties, const Span<const uint8_t> &payload = Span<const uint8_t>()){
+        Value value;
+        uint32_t count = 0;
+        size_t size = 0;
+
+        // Sizing pass, interning only affects the size of later frames
+        for(auto &property : properties){
+          if(property.first.size() > WIRE_MAX_KEY_LENGTH || !Encoder::valueOf(*property.second, value)){
+            continue;
+          }
+          size += this->keySize(property.first.c_str(), property.first.size()) + 1 + Encoder::valueSize(value);
+          count++;
+        }
+        if(payload.data()){
+          size += this->keySize("", 0) + 1 + varintSize(payload.size()) + payload.size();
+          count++;
+        }
+        size += 1 + varintSize(id) + varintSize(count);
+
+        this->_length = 0;
+        this->_ok = true;
+        this->_keys.rollback();
+
+        this->varint(size);
+        this->put(WIRE_VERSION);
+        this->varint(id);
+        this->varint(count);
+
+        for(auto &property : properties){
+          if(property.first.size() > WIRE_MAX_KEY_LENGTH || !Encoder::valueOf(*property.second, value)){
+            continue;
+          }
+          this->key(property.first.c_str(), property.first.size());
+          this->put(((uint8_t) value.width << 4) | (uint8_t) value.type);
+          switch(value.type){
+            case Type::UNSIGNED:
+            case Type::SIGNED:
+              this->varint(value.bits);
+              break;
+            case Type::FLOAT:
+              this->fixed(value.bits, 4);
+              break;
+            case Type::DOUBLE:
+              this->fixed(value.bits, 8);
+              break;
+            case Type::STRING:
+              this->varint(value.string->size());
+              this->put((const uint8_t*) value.string->data(), value.string->size());
+              break;
+            default:
+              break;
+          }
+        }
+        if(payload.data()){
+          this->key("", 0);
+          this->put((uint8_t) Type::BYTES);
+          this->varint(payload.size());
+          this->put(payload.data(), payload.size());
+        }
+        if(this->flush()){
+          this->_keys.commit();
+          return true;
+        }
+        this->_keys.rollback();
+        return false;
+      }
+
+      bool encode(const Message &message){
+        return this->encode(message.id, message, message.payload());
+      }
+
+      /**
+       * Forget interned keys, the Decoder must be reset() too
+      */
+      void reset(){
+        this->_keys.clear();
+      }
+
+    private:
+      struct Value {
+        Type type;
+        uint8_t width;      // log2 of an integer's size in bytes
+        uint64_t bits;
+        const std::string* string;
+      };
+
+      Sink _sink;
+      void* _context;
+      Keys _keys;
+
+      uint8_t _buffer[WIRE_BUFFER_SIZE];
+      size_t _length = 0;
+      bool _ok = true;
+
+      static constexpr uint8_t log2(const size_t size){
+        return size > 1 ? 1 + log2(size / 2) : 0;
+      }
+
+      template<typename T>
+      static bool unsignedOf(const PropertyType &property, Value &value){
+        const T* v = property.as<T>();
+        if(v){
+          value.type = Type::UNSIGNED;
+          value.width = log2(sizeof(T));
+          value.bits = *v;
+        }
+        return v;
+      }
+
+      template<typename T>
+      static bool signedOf(const PropertyType &property, Value &value){
+        const T* v = property.as<T>();
+        if(v){
+          value.type = Type::SIGNED;
+          value.width = log2(sizeof(T));
+          value.bits = zigzag(*v);
+        }
+        return v;
+      }
+
+      static bool valueOf(const PropertyType &property, Value &value){
+        value.width = 0;
+        if(const bool* b = property.as<bool>()){
+          value.type = *b ? Type::BOOLEAN_TRUE : Type::BOOLEAN_FALSE;
+          return true;
+        }
+        if(const float* f = property.as<float>()){
+          value.type = Type::FLOAT;
+          uint32_t bits;
+          memcpy(&bits, f, sizeof(bits));
+          value.bits = bits;
+          return true;
+        }
+        if(const double* d = property.as<double>()){
+          value.type = Type::DOUBLE;
+          memcpy(&value.bits, d, sizeof(value.bits));
+          return true;
+        }
+        if((value.string = property.as<std::string>())){
+          value.type = Type::STRING;
+          return true;
+        }
+        return unsignedOf<unsigned char>(property, value) || unsignedOf<unsigned short>(property, value)
+          || unsignedOf<unsigned int>(property, value) || unsignedOf<unsigned long>(property, value)
+          || unsignedOf<unsigned long long>(property, value)
+          || signedOf<signed char>(property, value) || signedOf<short>(property, value)
+          || signedOf<int>(property, value) || signedOf<long>(property, value)
+          || signedOf<long long>(property, value);
+      }
+
+      static size_t valueSize(const Value &value){
+        switch(value.type){
+          case Type::UNSIGNED:
+          case Type::SIGNED:
+            return varintSize(value.bits);
+          case Type::FLOAT:
+            return 4;
+          case Type::DOUBLE:
+            return 8;
+          case Type::STRING:
+            return varintSize(value.string->size()) + value.string->size();
+          default:
+            return 0;
+        }
+      }
+
+      size_t keySize(const char* key, size_t length) const {
+        int16_t index = this->_keys.find(key, length);
+        if(index >= 0){
+          return varintSize((index << 1) | 1);
+        }
+        return varintSize(length << 1) + length;
+      }
+
+      void key(const char* key, size_t length){
+        int16_t index = this->_keys.find(key, length);
+        if(index >= 0){
+          this->varint((index << 1) | 1);
+        }
+        else {
+          this->varint(length << 1);
+          this->put((const uint8_t*) key, length);
+          this->_keys.add(key, length);
+        }
+      }
+
+      bool flush(){
+        if(this->_ok && this->_length){
+          this->_ok = this->_sink(this->_buffer, this->_length, this->_context);
+        }
+        this->_length = 0;
+        return this->_ok;
+      }
+
+      void put(uint8_t byte){
+        if(this->_length == WIRE_BUFFER_SIZE){
+          this->flush();
+        }
+        this->_buffer[this->_length++] = byte;
+      }
+
+      void put(const uint8_t* data, size_t length){
+        for(size_t i = 0; i < length; i++){
+          this->put(data[i]);
+        }
+      }
+
+      void varint(uint64_t value){
+        while(value >= 0x80){
+          this->put((uint8_t) (value | 0x80));
+          value >>= 7;
+        }
+        this->put((uint8_t) value);
+      }
+
+      void fixed(uint64_t bits, uint8_t size){
+        for(uint8_t i = 0; i < size; i++){
+          this->put((uint8_t) (bits >> (i * 8)));
+        }
+      }
+  };
+
+
+  class Decoder {
+
+    public:
+      Decoder(const FieldCallback &onField, const FrameCallback &onFrame, void* context = nullptr) :
+        _onField(onField), _onFrame(onFrame), _context(context){}
+
+      /**
+       * Decode the next chunk of a stream, which may split frames anywhere, calling back for each field
+       * and completed frame. Returns false once the stream is corrupt or an unknown version, until reset()
+      */
+      bool feed(const uint8_t* data, size_t length){
+        for(size_t i = 0; i < length && this->_state != State::ERROR; i++){
+          this->step(data[i]);
+        }
+        return this->_state != State::ERROR;
+      }
+
+      /**
+       * Restart at a frame boundary and forget interned keys, the Encoder must be reset() too
+      */
+      void reset(){
+        this->_state = State::LENGTH;
+        this->_varint = 0;
+        this->_shift = 0;
+        this->_keys.clear();
+      }
+
+    private:
+      enum class State : uint8_t {
+        LENGTH,
+        VERSION,
+        ID,
+        COUNT,
+        KEY,
+        KEY_BYTES,
+        TYPE,
+        VARINT,
+        FIXED,
+        VALUE_LENGTH,
+        VALUE_BYTES,
+        ERROR,
+      };
+
+      FieldCallback _onField;
+      FrameCallback _onFrame;
+      void* _context;
+      Keys _keys;
+
+      State _state = State::LENGTH;
+      uint64_t _varint = 0;
+      uint8_t _shift = 0;
+
+      size_t _remaining = 0;      // Bytes left in the frame body
+      uint32_t _id = 0;
+      uint32_t _fields = 0;       // Fields left in the frame
+
+      Field _field;
+      char _key[WIRE_MAX_KEY_LENGTH + 1];
+      size_t _keyLength = 0;
+      uint8_t _value[WIRE_MAX_VALUE];
+      size_t _valueLength = 0;
+      uint8_t _fixed = 0;
+
+      /**
+       * Accumulate a varint byte, returns true once complete
+      */
+      bool varint(uint8_t byte){
+        if(this->_shift > 63){
+          this->_state = State::ERROR;
+          return false;
+        }
+        this->_varint |= (uint64_t) (byte & 0x7f) << this->_shift;
+        this->_shift += 7;
+        return !(byte & 0x80);
+      }
+
+      uint64_t take(){
+        uint64_t value = this->_varint;
+        this->_varint = 0;
+        this->_shift = 0;
+        return value;
+      }
+
+      void emit(){
+        this->_onField(this->_field, this->_context);
+      }
+
+      void next(){
+        if(--this->_fields > 0){
+          this->_state = State::KEY;
+        }
+        else {
+          this->end();
+        }
+      }
+
+      void end(){
+        if(this->_remaining != 0){
+          this->_state = State::ERROR;
+          return;
+        }
+        this->_keys.commit();
+        if(this->_onFrame){
+          this->_onFrame(this->_id, this->_context);
+        }
+        this->_state = State::LENGTH;
+      }
+
+      void step(uint8_t byte){
+        if(this->_state != State::LENGTH){
+          if(this->_remaining == 0){    // Overran the frame length
+            this->_state = State::ERROR;
+            return;
+          }
+          this->_remaining--;
+        }
+
+        switch(this->_state){
+          case State::LENGTH:
+            if(this->varint(byte)){
+              this->_remaining = this->take();
+              this->_state = this->_remaining ? State::VERSION : State::ERROR;
+            }
+            break;
+
+          case State::VERSION:
+            this->_keys.rollback();
+            this->_state = byte == WIRE_VERSION ? State::ID : State::ERROR;
+            break;
+
+          case State::ID:
+            if(this->varint(byte)){
+              this->_id = this->take();
+              this->_state = State::COUNT;
+            }
+            break;
+
+          case State::COUNT:
+            if(this->varint(byte)){
+              this->_fields = this->take();
+              if(this->_fields){
+                this->_state = State::KEY;
+              }
+              else {
+                this->end();
+              }
+            }
+            break;
+
+          case State::KEY:
+            if(this->varint(byte)){
+              uint64_t key = this->take();
+              if(key & 1){
+                if((key >> 1) >= this->_keys.count){
+                  this->_state = State::ERROR;
+                  break;
+                }
+                this->_field.key = this->_keys.keys[key >> 1];
+                this->_state = State::TYPE;
+              }
+              else if((key >> 1) > WIRE_MAX_KEY_LENGTH){
+                this->_state = State::ERROR;
+              }
+              else {
+                this->_keyLength = key >> 1;
+                this->_valueLength = 0;
+                this->_state = State::KEY_BYTES;
+                if(this->_keyLength == 0){
+                  this->key();
+                }
+              }
+            }
+            break;
+
+          case State::KEY_BYTES:
+            this->_key[this->_valueLength++] = byte;
+            if(this->_valueLength == this->_keyLength){
+              this->key();
+            }
+            break;
+
+          case State::TYPE:
+            this->type(byte);
+            break;
+
+          case State::VARINT:
+            if(this->varint(byte)){
+              if(this->_field.type == Type::SIGNED){
+                this->_field.value.i = unzigzag(this->take());
+              }
+              else {
+                this->_field.value.u = this->take();
+              }
+              this->emit();
+              this->next();
+            }
+            break;
+
+          case State::FIXED:
+            this->_varint |= (uint64_t) byte << (this->_shift * 8);
+            if(++this->_shift == this->_fixed){
+              uint64_t bits = this->take();
+              if(this->_field.type == Type::FLOAT){
+                uint32_t single = bits;
+                memcpy(&this->_field.value.f, &single, sizeof(single));
+              }
+              else {
+                memcpy(&this->_field.value.d, &bits, sizeof(bits));
+              }
+              this->emit();
+              this->next();
+            }
+            break;
+
+          case State::VALUE_LENGTH:
+            if(this->varint(byte)){
+              this->_field.total = this->take();
+              this->_field.offset = 0;
+              this->_valueLength = 0;
+              if(this->_field.total == 0){
+                this->_field.data = this->_value;
+                this->_field.length = 0;
+                this->emit();
+                this->next();
+              }
+              else {
+                this->_state = State::VALUE_BYTES;
+              }
+            }
+            break;
+
+          case State::VALUE_BYTES:
+            this->_value[this->_valueLength++] = byte;
+            if(this->_valueLength == WIRE_MAX_VALUE || this->_field.offset + this->_valueLength == this->_field.total){
+              this->_field.data = this->_value;
+              this->_field.length = this->_valueLength;
+              this->emit();
+              this->_field.offset += this->_valueLength;
+              this->_valueLength = 0;
+              if(this->_field.offset == this->_field.total){
+                this->next();
+              }
+            }
+            break;
+
+          case State::ERROR:
+            break;
+        }
+      }
+
+      void key(){
+        this->_key[this->_keyLength] = '\0';
+        const char* interned = this->_keys.add(this->_key, this->_keyLength);
+        this->_field.key = interned ? interned : this->_key;
+        this->_state = State::TYPE;
+      }
+
+      void type(uint8_t byte){
+        this->_field.type = (Type) (byte & 0x0f);
+        this->_field.width = 0;
+        this->_field.data = nullptr;
+        this->_field.length = this->_field.offset = this->_field.total = 0;
+
+        uint8_t width = byte >> 4;
+        bool integer = this->_field.type == Type::UNSIGNED || this->_field.type == Type::SIGNED;
+        if(width > (integer ? 3 : 0)){    // Only integers have a width, of up to 8 bytes
+          this->_state = State::ERROR;
+          return;
+        }
+
+        switch(this->_field.type){
+          case Type::BOOLEAN_FALSE:
+          case Type::BOOLEAN_TRUE:
+            this->_field.value.b = this->_field.type == Type::BOOLEAN_TRUE;
+            this->emit();
+            this->next();
+            break;
+          case Type::UNSIGNED:
+          case Type::SIGNED:
+            this->_field.width = 1 << width;
+            this->_state = State::VARINT;
+            break;
+          case Type::FLOAT:
+            this->_fixed = 4;
+            this->_state = State::FIXED;
+            break;
+          case Type::DOUBLE:
+            this->_fixed = 8;
+            this->_state = State::FIXED;
+            break;
+          case Type::STRING:
+          case Type::BYTES:
+            this->_state = State::VALUE_LENGTH;
+            break;
+          default:
+            this->_state = State::ERROR;
+        }
+      }
+  };
+
+}}
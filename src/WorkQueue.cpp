@@ -0,0 +1,66 @@
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+
+#include "WorkQueue.h"
+#include "Supervisor.h"
+#include "defs.h"
+
+
+namespace Postman {
+
+  INTERNAL_NS
+    Postman::Lock lock("jobs");
+  END_INTERNAL
+
+  void WorkQueue::init(){
+    NS::lock.init();
+  }
+
+  WorkQueue::WorkQueue(const uint32_t key, const uint8_t capacity) :
+    key(key),
+    capacity(capacity ? capacity : 1),
+    _jobs(new SharedConst<Message>[this->capacity]){}
+
+  bool WorkQueue::put(SharedConst<Message> job){
+    bool queued = false;
+
+    NS::lock.lock();
+      if(this->_tail - this->_head < this->capacity){
+        this->_jobs[this->_tail % this->capacity].swap(job);
+        this->_tail = this->_tail + 1;
+        this->posted = this->posted + 1;
+        queued = true;
+      }
+    NS::lock.unlock();
+
+    if(queued){
+      Supervisor::wake();   // Consumers blocked in read() may now take it
+    }
+    return queued;
+  }
+
+  SharedConst<Message> WorkQueue::take(){
+    SharedConst<Message> job;
+
+    NS::lock.lock();
+      if(this->_head != this->_tail){
+        job.swap(this->_jobs[this->_head % this->capacity]);
+        this->_head = this->_head + 1;
+        this->taken = this->taken + 1;
+      }
+    NS::lock.unlock();
+
+    if(job){
+      Supervisor::wake();   // Producers blocked in post() may now queue
+    }
+    return job;
+  }
+
+  uint8_t WorkQueue::depth() const {
+    return this->_tail - this->_head;
+  }
+
+}
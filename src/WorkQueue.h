@@ -0,0 +1,54 @@
+#pragma once
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include "Lock.h"
+#include "Message.h"
+#include "defs.h"
+#include "pointers.h"
+
+namespace Postman {
+
+  /**
+   * Bounded multi producer, multi consumer ring of jobs shared by a consumer group, see Postman::open_group().
+   * The M0+ has no atomic read-modify-write, so put() & take() serialise on a Lock held only to move one slot.
+   * The Lock is shared by every WorkQueue, as hardware spinlocks are few & a queue may be released
+  */
+  class WorkQueue {
+
+    public:
+      static void init();
+
+      WorkQueue(const uint32_t key, const uint8_t capacity);
+
+      const uint32_t key;   // Of the front Endpoint jobs are post()ed to
+      const uint8_t capacity;
+
+      /**
+       * Total jobs put() & taken
+      */
+      volatile uint32_t posted = 0;
+      volatile uint32_t taken = 0;
+
+      /**
+       * Queue job, false if the ring is full
+      */
+      bool put(SharedConst<Message> job);
+
+      /**
+       * Oldest job, or null if the ring is empty
+      */
+      SharedConst<Message> take();
+
+      uint8_t depth() const;
+
+    private:
+      Unique<SharedConst<Message>[]> _jobs;
+      volatile uint32_t _head = 0;    // Next to take
+      volatile uint32_t _tail = 0;    // Next to put
+
+  };
+
+}
@@ -21,6 +21,7 @@
 
 
 #include "Worker.h"
+#include "Clock.h"
 #include "defs.h"
 #include "Endpoint.h"
 #include "Dispatcher.h"
@@ -127,6 +128,11 @@ namespace Postman {
     this->stack_ptr = NS::initStackFrame(this->stack + WORKER_STACK_SIZE, handler, args, &Worker::oncomplete);
     this->endpoint = endpoint;
     this->state = WorkerState::READY;
+    this->_period = 0;
+    this->pending = false;    // Nothing of a previous handler's periodic jobs carries over
+    this->released = 0;
+    this->deadline = 0;
+    this->_quantum = endpoint->quantum ? endpoint->quantum : WORKER_TIME_SLICE;
   }
 
   bool Worker::bind(bool blocking){
@@ -170,9 +176,9 @@ namespace Postman {
     int64_t time_to_wait;
 
     if(hasState(WorkerState::SLEEPING)){
-      time_to_wait = absolute_time_diff_us(get_absolute_time(), this->timeout);
+      time_to_wait = absolute_time_diff_us(Clock::now(), this->timeout);
       if(time_to_wait > 0) {
-        this->timeout = make_timeout_time_us(time_to_wait);
+        this->timeout = Clock::after_us(time_to_wait);
         return true;
       }
       clearTimeout();
@@ -224,9 +230,47 @@ namespace Postman {
     return hasState(WorkerState::RUNNING);
   }
 
+  bool Worker::isBlocked(){
+    return hasState(WorkerState::BLOCKED);
+  }
+
+  bool Worker::hasTimeout(){
+    return hasState(WorkerState::SLEEPING);
+  }
+
+  bool Worker::isPeriodic(){
+    return this->_period > 0;
+  }
+
+  uint32_t Worker::quantum(){
+    return this->_quantum;
+  }
+
+  void Worker::account(const bool preempted){
+    if(preempted){
+      this->endpoint->preemptions++;
+    }
+
+    if(WORKER_ADAPTIVE_TIME_SLICE && this->_quantum > 0){
+      if(preempted){    // CPU bound, switch less often
+        this->_quantum = this->_quantum * 2 > WORKER_MAX_TIME_SLICE ? WORKER_MAX_TIME_SLICE : this->_quantum * 2;
+      }
+      else {            // Yielded early, keep the slice short for interactive Workers
+        this->_quantum = this->_quantum / 2 < WORKER_MIN_TIME_SLICE ? WORKER_MIN_TIME_SLICE : this->_quantum / 2;
+      }
+    }
+  }
+
   void Worker::sleep(const uint32_t duration_ms, bool blocking){
-    absolute_time_t timeout = make_timeout_time_ms(duration_ms);
-    if(!time_reached(timeout)){
+    this->sleepUntil(Clock::after_ms(duration_ms), blocking);
+  }
+
+  void Worker::sleepUntil(const absolute_time_t timeout, bool blocking){
+    // Nothing else can run here before timeout, so spin through the sleep rather than trap
+    while(!blocking && !Clock::reached(timeout) && Supervisor::alone(timeout)){
+      tight_loop_contents();
+    }
+    if(!Clock::reached(timeout)){
       int interrupts = save_and_disable_interrupts();
         this->timeout = timeout;
         setState(WorkerState::SLEEPING);
@@ -236,8 +280,28 @@ namespace Postman {
         __compiler_memory_barrier();
       restore_interrupts(interrupts);
       Worker::yield();
-      // Worker resumes here
+      // Worker resumes here, publish anything interrupts posted meanwhile
+      this->endpoint->deliver();
+    }
+  }
+
+  void Worker::periodic(const uint32_t period_us, const uint32_t deadline_us){
+    absolute_time_t now = Clock::now();
+
+    if(!this->isPeriodic()){    // First release is now
+      this->released = now;
+    }
+    else {
+      if(absolute_time_diff_us(this->deadline, now) > 0){
+        this->endpoint->deadlineMisses++;
+      }
+      // Release relative to the previous release, not the wake time, so the period doesn't drift
+      this->released = delayed_by_us(this->released, this->_period);
     }
+    this->_period = period_us;
+    this->deadline = delayed_by_us(this->released, deadline_us ? deadline_us : period_us);
+    this->pending = true;
+    this->sleepUntil(this->released);
   }
 
   Postman::Result Worker::block(const BlockingCallback &condition, Weak<Endpoint> target, const uint32_t timeout_ms){
@@ -260,8 +324,9 @@ namespace Postman {
     }
     else {
       Worker::yield();
+      this->endpoint->deliver();
     }
-    // Worker resumes here
+    // Worker resumes here, sleepUntil() delivered on the timeout path
     return this->_blockingResult;
     
   }
@@ -277,6 +342,7 @@ namespace Postman {
     if(this->bind(true)){
       this->clearState(WorkerState::SUSPENDED);
       this->release();
+      Supervisor::wake();
     }
   }
 
@@ -291,6 +357,7 @@ namespace Postman {
   }
 
   void Worker::halt(){
+    this->_period = 0;
     setState(WorkerState::ZOMBIE);
     while(1) Worker::yield();
   }
@@ -23,6 +23,18 @@ namespace Postman {
       */
       absolute_time_t timeout = 0;
 
+      /**
+       * Absolute release & deadline timestamps of the current periodic job
+      */
+      absolute_time_t released = 0;
+      absolute_time_t deadline = 0;
+
+      /**
+       * Set when a periodic job is released, cleared whenever the Worker is dispatched, by EDF or the round robin.
+       * A job that yields or overruns then carries on in the round robin, so it can't starve the other Workers
+      */
+      volatile bool pending = false;
+
       Worker();
 
       __force_inline static void yield(void){
@@ -42,8 +54,20 @@ namespace Postman {
       bool isSleeping();
       bool isSuspended();
       bool isZombie();
+      bool isPeriodic();
+
+      /**
+       * State flags only, without re-evaluating the timeout or blocking condition. Safe from any core
+      */
+      bool isBlocked();
+      bool hasTimeout();
+
+      uint32_t quantum();                   // Current time slice in us
+      void account(const bool preempted);   // Account for the end of a dispatch
 
       void sleep(const uint32_t duration_ms, bool blocking = false);
+      void sleepUntil(const absolute_time_t timeout, bool blocking = false);
+      void periodic(const uint32_t period_us, const uint32_t deadline_us = 0);  // Complete current job and sleep until next release
       Postman::Result block(const BlockingCallback &condition, Weak<Endpoint> target, const uint32_t timeout_ms = 0);
       
       void suspend();   // Suspend this Worker until resume()d
@@ -56,6 +80,8 @@ namespace Postman {
       volatile uint8_t _core = CORE_NONE;
       
       volatile uint16_t state = 0;
+      uint32_t _period = 0;     // us
+      uint32_t _quantum = WORKER_TIME_SLICE;
       uint32_t __attribute__((aligned(8))) stack[WORKER_STACK_SIZE];        // Worker stack
       uint32_t* stack_ptr = 0; 
 
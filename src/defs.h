@@ -28,6 +28,7 @@ namespace Postman {
     WORKER_NOT_AVAILABLE,
     WORKER_BOUND,
     WORKER_NOT_BOUND,
+    MESSAGE_OVERRUN,
     TIMEOUT,
   };
 }
@@ -46,6 +47,75 @@ namespace Postman {
  */
 #define MESSAGE_BANK_SIZE 50
 
+/**
+ * @brief Number of pooled binary payload Buffers. 
+ */
+#define BUFFER_POOL_SIZE 8
+
+/**
+ * @brief Size of a pooled Buffer in bytes. 
+ */
+#define BUFFER_SIZE 2048
+
+/**
+ * @brief Wire format version, the first byte of every encoded frame body
+ */
+#define WIRE_VERSION 2
+
+/**
+ * @brief Number of property keys a Wire Encoder/Decoder pair interns per stream
+ */
+#define WIRE_MAX_KEYS 32
+
+/**
+ * @brief Maximum length of a Wire property key, longer keys are not encoded
+ */
+#define WIRE_MAX_KEY_LENGTH 32
+
+/**
+ * @brief Wire Decoder scratch size, longer string & byte values are delivered in chunks
+ */
+#define WIRE_MAX_VALUE 64
+
+/**
+ * @brief Wire Encoder output buffer, passed to the sink whenever full
+ */
+#define WIRE_BUFFER_SIZE 64
+
+/**
+ * @brief Bridge output buffer, frames are batched into it and written to the transport when full or each poll
+ */
+#define BRIDGE_BUFFER_SIZE 256
+
+/**
+ * @brief Number of PUBLISH & NOTIFY frames a Bridge may have in flight before its peer returns credit
+ */
+#define BRIDGE_CREDITS 8
+
+/**
+ * @brief Number of slots in the Endpoint registry hash table.
+ * @note Must be a **power of 2**, and larger than the number of concurrently open Endpoints
+ */
+#define ENDPOINT_REGISTRY_SIZE 64
+
+/**
+ * @brief Number of members notify_group() collects on the stack per registry Lock acquisition.
+ * Larger groups take one pass per batch
+ */
+#define NOTIFY_GROUP_BATCH 8
+
+/**
+ * @brief Maximum number of published Messages an Endpoint may retain as history.
+ * @note Retained Messages are held out of the Message bank until overwritten
+ */
+#define ENDPOINT_MAX_HISTORY 16
+
+/**
+ * @brief Number of isr_post() values an Endpoint holds until its Worker next resumes and publishes them.
+ * Values posted while it is full are dropped and counted in the Endpoint's pendingDropped
+ */
+#define ENDPOINT_PENDING_SIZE 4
+
 
 /**
  * @brief Size of a Worker stack in 32 bit words. 
@@ -62,6 +132,16 @@ namespace Postman {
  * Setting time slice to zero will disable preemptive scheduling!
 */
 #define WORKER_TIME_SLICE 1000
+
+/**
+ * @brief Enable/disable adaptive Worker time slices
+ * 
+ * If true, a Worker preempted at the end of its time slice has it doubled, and
+ * one that yields early has it halved, within the bounds below.
+*/
+#define WORKER_ADAPTIVE_TIME_SLICE false
+#define WORKER_MIN_TIME_SLICE 250
+#define WORKER_MAX_TIME_SLICE 8000
 /**
  * @brief The maximum time that the dispatcher will sleep in the idle task (in usec).
  * 
@@ -70,6 +150,11 @@ namespace Postman {
 */
 #define DISPATCHER_MAX_IDLE_TIME 700
 
+/**
+ * @brief Number of deferred interrupt requests each Dispatcher can queue between passes.
+ */
+#define DISPATCHER_DEFERRED_SIZE 32
+
 /**
  * @brief If true, the dispatcher will not idle (sleep) if tasks are blocking for signals.
  * 
@@ -82,9 +167,99 @@ namespace Postman {
  */
 #define DISPATCHER_NO_IDLE_FOR_SIGNALS true
 
+/**
+ * @brief Enable/disable earliest deadline first scheduling of periodic Workers
+ * 
+ * If true, released periodic Workers are dispatched ahead of the round robin
+ * in order of their absolute deadline.
+**/
+#define DISPATCHER_EDF true
+
+/**
+ * @brief Enable/disable the fast path for yield() & short sleeps
+ * 
+ * If true, a Worker that was the only runnable Worker on its core in the last pass
+ * returns from yield(), or spins through a sleep ending within its time slice, without
+ * trapping into the Dispatcher, until a signal, publish, new Worker or timeout could
+ * make another Worker runnable.
+**/
+#define DISPATCHER_FAST_YIELD true
+
+/**
+ * @brief Enable/disable Lock contention profiling
+ * 
+ * If true, every Lock records acquisitions, contended acquisitions, spin and hold times.
+ * Adds two timer reads to every acquisition.
+**/
+#define LOCK_PROFILING false
+
+/**
+ * @brief Maximum number of Locks registered for profiling
+**/
+#define LOCK_PROFILE_SIZE 16
+
+/**
+ * @brief Enable/disable publish & notify tracing
+ * 
+ * If true, Trace::capture() can record traffic, and publish to fetch latency is measured
+ * for up to TRACE_MAX_ENDPOINTS Endpoints.
+**/
+#define TRACE false
+#define TRACE_MAX_ENDPOINTS 16
+
+/**
+ * @brief Default number of jobs a consumer group's work queue holds, see Postman::open_group()
+ */
+#define WORK_QUEUE_SIZE 16
+
+/**
+ * @brief Number of helper Workers parallel_for() spreads a range across, alongside the calling handler
+ * 
+ * Each holds a Worker from the pool. One lets a range use both cores, 0 runs ranges inline.
+**/
+#define FORK_HELPERS 1
+
+/**
+ * @brief Period of the /postman/stats Endpoint's kernel metrics Message in ms, 0 disables it
+ * 
+ * Each sample walks the Worker pool and at most STATS_MAX_ENDPOINTS Endpoints for their CPU time.
+**/
+#define STATS_PERIOD_MS 1000
+#define STATS_MAX_ENDPOINTS 16
+
+/**
+ * @brief Enable/disable heap accounting by subsystem & Endpoint, see Memory.h
+ * 
+ * Adds a Lock acquisition to every accounted allocation & free.
+**/
+#define MEMORY_ACCOUNTING false
+
+/**
+ * @brief Enable/disable fixed size block pools for kernel allocations, see Memory.h
+ * 
+ * Property values & map nodes, registry nodes and shared_ptr control blocks are taken from
+ * pools of 16, 32, 64 & 128 byte blocks, with the number of blocks in each below.
+**/
+#define MEMORY_POOLS false
+#define MEMORY_POOL_16 64
+#define MEMORY_POOL_32 64
+#define MEMORY_POOL_64 32
+#define MEMORY_POOL_128 16
+
 /**
  * @brief Enable/disable multi-core scheduling
  * 
 **/
 #define DISPATCHER_MULTICORE true
 
+/**
+ * @brief Enable/disable deterministic simulation
+ * 
+ * If true, kernel time is a virtual clock and the two Dispatchers run in lockstep, taking turns
+ * chosen by a seeded Schedule. Preemption is disabled so handlers must yield. Each dispatch advances
+ * the clock by SIMULATION_DISPATCH_COST, and once every Dispatcher is idle it jumps to the next timeout.
+**/
+#define SIMULATION false
+#define SIMULATION_SEED 1
+#define SIMULATION_DISPATCH_COST 10
+
@@ -72,9 +72,8 @@ void handler_E(){
   uint32_t messageid = 0;
 
   while (1) {
-    SharedConst<Postman::Message> message = Postman::fetch(ENDPOINT_F, messageid);
+    SharedConst<Postman::Message> message = Postman::fetch(ENDPOINT_F, messageid, 0, &messageid);
     if(message){
-      messageid = message->id;
       uint32_t time_ms = message->getProperty<uint32_t>("time");
       std::string data = message->getProperty<std::string>("data");
       printf("[%i] :: Endpoint E - Fetch Message time: %lu Data: %s\n", get_core_num(), time_ms, data.c_str());
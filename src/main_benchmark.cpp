@@ -0,0 +1,336 @@
+/**
+ * @copyright Copyright (C) 2023 Neil Stansbury
+ * All rights reserved.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "pico/stdlib.h"
+
+#include <Postman.h>
+#include <Histogram.h>
+#include <Worker.h>
+
+/**
+ * Micro-benchmarks of the kernel's hot paths, built by the "benchmark" env in place of main.cpp.
+ * Each result is printed as one JSON line so runs can be captured from the serial port & compared
+ * across releases. Times come from the 1us timer, so fast operations are timed in batches of BATCH
+ * and reported in ns per operation.
+*/
+
+#define SAMPLES 1000
+#define BATCH 100
+#define MAX_READERS 4
+
+// The app, GC, stats & fork helper Workers, the rest of the pool is shared by the idle Workers
+#define KERNEL_WORKERS (2 + (STATS_PERIOD_MS ? 1 : 0) + FORK_HELPERS)
+#define MAX_IDLE ((WORKER_POOL_SIZE - KERNEL_WORKERS) / 2)
+
+static_assert(MAX_IDLE >= 4 && MAX_READERS <= WORKER_POOL_SIZE - KERNEL_WORKERS, "WORKER_POOL_SIZE is too small for the benchmarks");
+
+const std::string BENCH = "/bench";
+
+using Postman::Histogram;
+
+void report(const char* benchmark, const char* params, const char* unit, const Histogram &histogram){
+  histogram.print(benchmark, params, unit);
+}
+
+/**
+ * Block until count helpers have notify()ed the benchmark Endpoint
+*/
+void join(uint8_t count){
+  while(count){
+    uint8_t signals = Postman::wait(5000);
+    if(!signals){
+      printf("{\"error\":\"join timeout\",\"pending\":%u}\n", count);
+      return;
+    }
+    count = signals > count ? 0 : count - signals;
+  }
+}
+
+/**
+ * Block until the GC has released every Endpoint matching pattern, so their Workers are free again
+*/
+void reap(const std::string &pattern){
+  for(uint32_t waited = 0; !Postman::match(pattern).empty(); waited++){
+    if(waited == 5000){
+      printf("{\"error\":\"reap timeout\",\"pattern\":\"%s\"}\n", pattern.c_str());
+      return;
+    }
+    Postman::sleep(1);
+  }
+}
+
+/**
+ * Open a benchmark helper, reporting if the registry or Worker pool is exhausted
+*/
+bool spawn(const std::string &uri, const Postman::Endpoint::Handler &handler){
+  if(!Postman::open(uri, handler)){
+    printf("{\"error\":\"open failed\",\"uri\":\"%s\"}\n", uri.c_str());
+    return false;
+  }
+  return true;
+}
+
+
+/**
+ * Context switch: round trip through the Dispatcher via yield(), against idle sleeping & blocked Workers.
+ * The app is the only runnable Worker, so Postman::yield() takes the DISPATCHER_FAST_YIELD path. The trap
+ * is timed directly as "yield", and Postman::yield() separately as "yield_alone"
+*/
+volatile bool idle_stop = false;
+
+void bench_yield(const char* params){
+  Histogram trap;
+  for(uint32_t i = 0; i < SAMPLES; i++){
+    uint32_t start = time_us_32();
+    Postman::Worker::yield();
+    trap.add(time_us_32() - start);
+  }
+  report("yield", params, "us", trap);
+
+  if(DISPATCHER_FAST_YIELD){
+    Histogram alone;
+    for(uint32_t i = 0; i < SAMPLES; i++){
+      uint32_t start = time_us_32();
+      Postman::yield();
+      alone.add(time_us_32() - start);
+    }
+    report("yield_alone", params, "us", alone);
+  }
+}
+
+void bench_scheduler(){
+  const uint8_t idle[] = {0, 2, 4, MAX_IDLE};
+  char params[48];
+  char uri[32];
+
+  for(uint8_t count : idle){
+    idle_stop = false;
+    uint8_t opened = 0;
+    for(uint8_t i = 0; i < count; i++){
+      // Each round has its own URIs, as the last round's are only released once the GC reaps them
+      snprintf(uri, sizeof(uri), "/bench/idle/%u/sleeping/%u", count, i);
+      opened += spawn(uri, [](){
+        while(!idle_stop){
+          Postman::sleep(100);
+        }
+        Postman::notify(BENCH);
+      });
+      snprintf(uri, sizeof(uri), "/bench/idle/%u/blocked/%u", count, i);
+      opened += spawn(uri, [](){
+        while(!idle_stop){
+          Postman::wait();
+        }
+        Postman::notify(BENCH);
+      });
+    }
+    Postman::sleep(10);   // Let every idle Worker block
+
+    snprintf(params, sizeof(params), "sleeping=%u,blocked=%u", count, count);
+    bench_yield(params);
+
+    idle_stop = true;
+    snprintf(uri, sizeof(uri), "/bench/idle/%u/**", count);
+    Postman::notify_group(uri);
+    join(opened);
+    reap(uri);
+  }
+}
+
+
+/**
+ * notify() -> wait() ping pong, round trip latency
+*/
+void bench_ping_pong(){
+  Histogram histogram;
+  bool opened = spawn("/bench/pong", [](){
+    for(uint32_t i = 0; i < SAMPLES; i++){
+      Postman::wait();
+      Postman::notify(BENCH);
+    }
+  });
+  if(!opened){
+    return;
+  }
+  Postman::sleep(10);
+
+  for(uint32_t i = 0; i < SAMPLES; i++){
+    uint32_t start = time_us_32();
+    Postman::notify("/bench/pong");
+    Postman::wait();
+    histogram.add(time_us_32() - start);
+  }
+  report("notify_wait", "", "us", histogram);
+  reap("/bench/pong");
+}
+
+
+/**
+ * publish() -> fetch() latency with 1..MAX_READERS readers
+*/
+Histogram readers[MAX_READERS];
+uint8_t reader_next = 0;
+
+void reader(){
+  Histogram &histogram = readers[reader_next++];
+  uint32_t since = 0;
+  Postman::notify(BENCH);   // Readers start one at a time
+
+  while(1){
+    SharedConst<Postman::Message> message = Postman::fetch(BENCH, since, 1000, &since);
+    if(!message || message->hasProperty<bool>("stop")){
+      break;
+    }
+    histogram.add(time_us_32() - message->getProperty<uint32_t>("time"));
+  }
+  Postman::notify(BENCH);
+}
+
+void bench_publish_fetch(){
+  char params[16];
+  char uri[32];
+
+  for(uint8_t count = 1; count <= MAX_READERS; count *= 2){
+    reader_next = 0;
+    uint8_t opened = 0;
+    for(uint8_t i = 0; i < count; i++){
+      readers[i] = Histogram();
+      snprintf(uri, sizeof(uri), "/bench/reader/%u/%u", count, i);
+      if(spawn(uri, reader)){
+        join(1);
+        opened++;
+      }
+    }
+
+    for(uint32_t i = 0; i < SAMPLES; i++){
+      Shared<Postman::Message> message = Postman::compose();
+      message->setProperty<uint32_t>("time", time_us_32());
+      Postman::publish(message);
+      Postman::sleep(1);   // Readers keep up with the latest publish
+    }
+    Shared<Postman::Message> stop = Postman::compose();
+    stop->setProperty("stop", true);
+    Postman::publish(stop);
+    join(opened);
+
+    Histogram histogram;
+    for(uint8_t i = 0; i < opened; i++){
+      histogram.merge(readers[i]);
+    }
+    snprintf(params, sizeof(params), "readers=%u", opened);
+    report("publish_fetch", params, "us", histogram);
+
+    snprintf(uri, sizeof(uri), "/bench/reader/%u/**", count);
+    reap(uri);
+  }
+}
+
+
+/**
+ * compose() & release back to the Message bank
+*/
+void bench_compose(){
+  Histogram histogram;
+  for(uint32_t i = 0; i < SAMPLES; i++){
+    uint32_t start = time_us_32();
+    for(uint32_t j = 0; j < BATCH; j++){
+      Shared<Postman::Message> message = Postman::compose();
+    }
+    histogram.add((time_us_32() - start) * 1000 / BATCH);
+  }
+  report("compose_release", "", "ns", histogram);
+}
+
+
+/**
+ * setProperty() & getProperty() by type, with keys properties already set
+*/
+template<typename T>
+void bench_properties(const char* type, const T value){
+  const uint8_t sizes[] = {1, 8, 32};
+  char params[32];
+
+  for(uint8_t keys : sizes){
+    PropertySet properties;
+    std::vector<std::string> names(keys);
+    for(uint8_t i = 0; i < keys; i++){
+      names[i] = "property" + std::to_string(i);
+      properties.setProperty<T>(names[i], value);
+    }
+    const std::string &name = names[keys / 2];
+
+    Histogram set;
+    Histogram get;
+    for(uint32_t i = 0; i < SAMPLES; i++){
+      uint32_t start = time_us_32();
+      for(uint32_t j = 0; j < BATCH; j++){
+        properties.setProperty<T>(name, value);
+      }
+      set.add((time_us_32() - start) * 1000 / BATCH);
+
+      start = time_us_32();
+      for(uint32_t j = 0; j < BATCH; j++){
+        const T &found = properties.getProperty<T>(name);
+        __asm volatile("" : : "r"(&found));
+      }
+      get.add((time_us_32() - start) * 1000 / BATCH);
+    }
+    snprintf(params, sizeof(params), "type=%s,keys=%u", type, keys);
+    report("setProperty", params, "ns", set);
+    report("getProperty", params, "ns", get);
+  }
+}
+
+
+/**
+ * Endpoint lookup by URI, through the registry
+*/
+void bench_lookup(){
+  Histogram histogram;
+  const std::string uri = "/bench/lookup";
+  if(!spawn(uri, [](){ Postman::wait(); })){
+    return;
+  }
+
+  for(uint32_t i = 0; i < SAMPLES; i++){
+    uint32_t start = time_us_32();
+    for(uint32_t j = 0; j < BATCH; j++){
+      Shared<Postman::Endpoint> endpoint = Postman::handle(uri);
+    }
+    histogram.add((time_us_32() - start) * 1000 / BATCH);
+  }
+  report("endpoint_get", "", "ns", histogram);
+  Postman::notify(uri);
+}
+
+
+void app(){
+  printf("{\"suite\":\"postman\",\"samples\":%u,\"batch\":%u}\n", SAMPLES, BATCH);
+
+  bench_scheduler();
+  bench_ping_pong();
+  bench_publish_fetch();
+  bench_compose();
+  bench_properties<uint32_t>("uint32_t", 42);
+  bench_properties<float>("float", 4.2f);
+  bench_properties<std::string>("string", "forty two");
+  bench_lookup();
+
+  printf("{\"suite\":\"postman\",\"done\":true}\n");
+  while(1){
+    Postman::sleep(1000);
+  }
+}
+
+
+int main() {
+  stdio_init_all();
+
+  sleep_ms(10000);
+
+  Postman::start(BENCH, app);
+}
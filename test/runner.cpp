@@ -1,9 +1,13 @@
 
 #include "./tests/testsuite_properties.cpp"
+#include "./tests/testsuite_wire.cpp"
+#include "./tests/testsuite_schedule.cpp"
 
 
 int run_testsuites(void) {
   testsuite_properties::run();
+  testsuite_wire::run();
+  testsuite_schedule::run();
   
   return 0;
 }
@@ -107,6 +107,39 @@ struct testsuite_properties {
     TEST_ASSERT_TRUE(actualValue);
   }
 
+  static void test_findProperty_array(void) {
+    auto propertyName = std::string("ArrProp");
+
+    auto actualValue = properties->findProperty<std::array<int, 5>>(propertyName);
+
+    TEST_ASSERT_NOT_NULL(actualValue);
+    TEST_ASSERT_EQUAL(3, (*actualValue)[2]);
+  }
+
+  static void test_findProperty_type_mismatch(void) {
+    auto propertyName = std::string("StrProp");
+
+    auto actualValue = properties->findProperty<int>(propertyName);
+
+    TEST_ASSERT_NULL(actualValue);
+  }
+
+  static void test_getProperty_reference_not_copied(void) {
+    auto propertyName = std::string("StrProp");
+
+    const std::string &first = properties->getProperty<std::string>(propertyName);
+    const std::string &second = properties->getProperty<std::string>(propertyName);
+
+    TEST_ASSERT_TRUE(&first == &second);
+    TEST_ASSERT_TRUE(&first == properties->findProperty<std::string>(propertyName));
+  }
+
+  static void test_getProperty_missing_default(void) {
+    auto actualValue = properties->getProperty<int>("MissingProp");
+
+    TEST_ASSERT_EQUAL(0, actualValue);
+  }
+
   static void setup(){
     properties = Unique<PropertySet>(new PropertySet());
     UNITY_BEGIN();
@@ -131,6 +164,11 @@ struct testsuite_properties {
     RUN_TEST(test_hasProperty_type_array);
     RUN_TEST(test_hasProperty_name);
 
+    RUN_TEST(test_findProperty_array);
+    RUN_TEST(test_findProperty_type_mismatch);
+    RUN_TEST(test_getProperty_reference_not_copied);
+    RUN_TEST(test_getProperty_missing_default);
+
     finish();
   }
 };
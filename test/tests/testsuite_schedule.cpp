@@ -0,0 +1,111 @@
+#pragma once
+
+#include <unity.h>
+
+#include <string>
+
+#include <Schedule.h>
+
+
+struct testsuite_schedule {
+
+  static std::string choices(Postman::Schedule &schedule, uint32_t steps, uint8_t cores = 2){
+    std::string choices;
+    for(uint32_t i = 0; i < steps; i++){
+      choices += (char) ('0' + schedule.next(cores));
+    }
+    return choices;
+  }
+
+  static void test_same_seed_same_interleaving(){
+    Postman::Schedule a(42);
+    Postman::Schedule b(42);
+    Postman::Schedule c(43);
+
+    std::string first = choices(a, 256);
+    TEST_ASSERT_EQUAL_STRING(first.c_str(), choices(b, 256).c_str());
+    TEST_ASSERT_TRUE(first != choices(c, 256));
+    TEST_ASSERT_TRUE(first.find('0') != std::string::npos && first.find('1') != std::string::npos);
+
+    a.reset(42);
+    TEST_ASSERT_EQUAL_STRING(first.c_str(), choices(a, 256).c_str());
+    TEST_ASSERT_EQUAL(256, a.steps());
+  }
+
+  static void test_replay_then_seed(){
+    Postman::Schedule seeded(7);
+    std::string tail = choices(seeded, 16);
+
+    Postman::Schedule schedule(7);
+    schedule.replay("0011");
+    std::string all = choices(schedule, 20);
+
+    TEST_ASSERT_EQUAL_STRING("0011", all.substr(0, 4).c_str());
+    TEST_ASSERT_EQUAL_STRING(tail.c_str(), all.substr(4).c_str());
+  }
+
+  static void test_single_core(){
+    Postman::Schedule schedule(99);
+    schedule.replay("1");
+    TEST_ASSERT_EQUAL_STRING(std::string(64, '0').c_str(), choices(schedule, 64, 1).c_str());
+  }
+
+  static void test_idle_jumps_to_earliest_wake(){
+    Postman::Lockstep lockstep;
+    lockstep.start(1000, 2);
+
+    lockstep.idle(0, 500);                  // Core 0 wakes at 1500
+    TEST_ASSERT_EQUAL(1000, lockstep.now());
+    lockstep.end(1, true, 10);              // Core 1 dispatches, the clock moves on
+    lockstep.idle(1, 200);                  // Its pass wasn't idle
+    TEST_ASSERT_EQUAL(1010, lockstep.now());
+    TEST_ASSERT_TRUE(lockstep.wake(1) == Postman::Lockstep::AWAKE);
+
+    lockstep.idle(1, 600);                  // Core 1 wakes at 1610, core 0 is still due at 1500 not 1510
+    TEST_ASSERT_EQUAL(1500, lockstep.now());
+    TEST_ASSERT_TRUE(lockstep.wake(0) == Postman::Lockstep::AWAKE);
+
+    lockstep.idle(0, 0);                    // A timeout already due still moves the clock on
+    lockstep.idle(1, 0);
+    TEST_ASSERT_EQUAL(1501, lockstep.now());
+  }
+
+  static void test_lockstep_turns(){
+    Postman::Lockstep lockstep;
+    lockstep.schedule.replay("0110");
+    lockstep.start(0, 2);
+
+    std::string turns;
+    turns += (char) ('0' + lockstep.end(0, true, 10));
+    turns += (char) ('0' + lockstep.idle(0, 100));
+    turns += (char) ('0' + lockstep.end(1, false, 10));
+    turns += (char) ('0' + lockstep.idle(1, 100));
+    TEST_ASSERT_EQUAL_STRING("0110", turns.c_str());
+    TEST_ASSERT_EQUAL(10, lockstep.now());  // Only the dispatched step cost time
+    TEST_ASSERT_EQUAL(4, lockstep.schedule.steps());
+
+    lockstep.start(0, 1);                   // A single core always keeps the turn, & jumps alone
+    TEST_ASSERT_EQUAL(0, lockstep.idle(0, 100));
+    TEST_ASSERT_EQUAL(100, lockstep.now());
+  }
+
+  static void setup(){
+    UNITY_BEGIN();
+  }
+
+  static void finish(){
+    UNITY_END();
+  }
+
+  static void run(){
+    setup();
+
+    RUN_TEST(test_same_seed_same_interleaving);
+    RUN_TEST(test_replay_then_seed);
+    RUN_TEST(test_single_core);
+    RUN_TEST(test_idle_jumps_to_earliest_wake);
+    RUN_TEST(test_lockstep_turns);
+
+    finish();
+  }
+};
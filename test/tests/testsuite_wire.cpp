@@ -0,0 +1,240 @@
+#pragma once
+
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+
+#include <Properties.h>
+#include <Wire.h>
+
+
+struct testsuite_wire {
+
+  struct Decoded {
+    std::string key;
+    Postman::Wire::Field field;
+    std::string bytes;
+  };
+
+  static std::vector<uint8_t>& stream(){
+    static std::vector<uint8_t> stream;
+    return stream;
+  }
+
+  static std::vector<Decoded>& fields(){
+    static std::vector<Decoded> fields;
+    return fields;
+  }
+
+  static uint32_t& frames(){
+    static uint32_t frames = 0;
+    return frames;
+  }
+
+  static bool& failing(){
+    static bool failing = false;
+    return failing;
+  }
+
+  static bool sink(const uint8_t* data, size_t length, void* context){
+    if(failing()){
+      return false;
+    }
+    stream().insert(stream().end(), data, data + length);
+    return true;
+  }
+
+  static void onField(const Postman::Wire::Field &field, void* context){
+    if(field.offset > 0){   // Continuation chunk
+      fields().back().bytes.append((const char*) field.data, field.length);
+      return;
+    }
+    Decoded decoded = { field.key, field, std::string() };
+    if(field.data){
+      decoded.bytes.assign((const char*) field.data, field.length);
+    }
+    fields().push_back(decoded);
+  }
+
+  static void onFrame(uint32_t id, void* context){
+    frames() = id;
+  }
+
+  static const Decoded* find(const std::string &key){
+    for(auto &decoded : fields()){
+      if(decoded.key == key){
+        return &decoded;
+      }
+    }
+    return nullptr;
+  }
+
+  static PropertySet sample(){
+    PropertySet properties;
+    properties.setProperty("flag", true);
+    properties.setProperty("time", uint32_t(123456));
+    properties.setProperty("offset", int(-42));
+    properties.setProperty("ratio", 0.5f);
+    properties.setProperty("precise", 3.14159265358979);
+    properties.setProperty("data", std::string("Endpoint F"));
+    return properties;
+  }
+
+  static void reset(){
+    failing() = false;
+    stream().clear();
+    fields().clear();
+    frames() = 0;
+  }
+
+  static void test_roundtrip_scalars(void) {
+    reset();
+    Postman::Wire::Encoder encoder(sink);
+    Postman::Wire::Decoder decoder(onField, onFrame);
+
+    TEST_ASSERT_TRUE(encoder.encode(7, sample()));
+    TEST_ASSERT_TRUE(decoder.feed(stream().data(), stream().size()));
+
+    TEST_ASSERT_EQUAL(7, frames());
+    TEST_ASSERT_EQUAL(6, fields().size());
+    TEST_ASSERT_TRUE(find("flag")->field.value.b);
+    TEST_ASSERT_EQUAL(123456, find("time")->field.value.u);
+    TEST_ASSERT_EQUAL(-42, find("offset")->field.value.i);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, find("ratio")->field.value.f);
+    TEST_ASSERT_TRUE(find("precise")->field.value.d == 3.14159265358979);
+    TEST_ASSERT_TRUE(find("data")->bytes == "Endpoint F");
+  }
+
+  static void test_interned_keys_shrink_frames(void) {
+    reset();
+    Postman::Wire::Encoder encoder(sink);
+    Postman::Wire::Decoder decoder(onField, onFrame);
+
+    encoder.encode(1, sample());
+    size_t first = stream().size();
+    encoder.encode(2, sample());
+    size_t second = stream().size() - first;
+
+    TEST_ASSERT_TRUE(second < first);
+    TEST_ASSERT_TRUE(decoder.feed(stream().data(), stream().size()));
+    TEST_ASSERT_EQUAL(2, frames());
+    TEST_ASSERT_EQUAL(12, fields().size());
+    TEST_ASSERT_TRUE(fields()[6].key == fields()[0].key);
+  }
+
+  static void test_byte_by_byte_feed(void) {
+    reset();
+    Postman::Wire::Encoder encoder(sink);
+    Postman::Wire::Decoder decoder(onField, onFrame);
+
+    encoder.encode(3, sample());
+    for(uint8_t byte : stream()){
+      TEST_ASSERT_TRUE(decoder.feed(&byte, 1));
+    }
+
+    TEST_ASSERT_EQUAL(3, frames());
+    TEST_ASSERT_EQUAL(6, fields().size());
+    TEST_ASSERT_EQUAL(-42, find("offset")->field.value.i);
+  }
+
+  static void test_long_value_chunks(void) {
+    reset();
+    Postman::Wire::Encoder encoder(sink);
+    Postman::Wire::Decoder decoder(onField, onFrame);
+
+    std::string value(WIRE_MAX_VALUE * 3 + 5, 'x');
+    std::vector<uint8_t> payload(300, 0xA5);
+    PropertySet properties;
+    properties.setProperty("long", value);
+
+    encoder.encode(4, properties, Postman::Span<const uint8_t>(payload.data(), payload.size()));
+    TEST_ASSERT_TRUE(decoder.feed(stream().data(), stream().size()));
+
+    TEST_ASSERT_TRUE(find("long")->bytes == value);
+    TEST_ASSERT_EQUAL(payload.size(), find("")->bytes.size());
+    TEST_ASSERT_TRUE(find("")->field.type == Postman::Wire::Type::BYTES);
+  }
+
+  static void test_unknown_version(void) {
+    reset();
+    Postman::Wire::Encoder encoder(sink);
+    Postman::Wire::Decoder decoder(onField, onFrame);
+
+    encoder.encode(5, sample());
+    stream()[1] = WIRE_VERSION + 1;
+
+    TEST_ASSERT_FALSE(decoder.feed(stream().data(), stream().size()));
+    TEST_ASSERT_EQUAL(0, fields().size());
+  }
+
+  static void test_integer_widths(void) {
+    reset();
+    Postman::Wire::Encoder encoder(sink);
+    Postman::Wire::Decoder decoder(onField, onFrame);
+
+    PropertySet properties;
+    properties.setProperty("u8", uint8_t(200));
+    properties.setProperty("i16", int16_t(-300));
+    properties.setProperty("u32", uint32_t(7));
+    properties.setProperty("i32", int(-7));
+    properties.setProperty("u64", uint64_t(5));
+    properties.setProperty("i64", int64_t(-5));
+
+    encoder.encode(6, properties);
+    TEST_ASSERT_TRUE(decoder.feed(stream().data(), stream().size()));
+
+    PropertySet decoded;
+    std::string scratch;
+    for(auto &field : fields()){
+      field.field.key = field.key.c_str();
+      TEST_ASSERT_TRUE(Postman::Wire::assign(decoded, field.field, scratch));
+    }
+    TEST_ASSERT_EQUAL(200, decoded.getProperty<uint8_t>("u8"));
+    TEST_ASSERT_EQUAL(-300, decoded.getProperty<int16_t>("i16"));
+    TEST_ASSERT_EQUAL(7, decoded.getProperty<uint32_t>("u32"));
+    TEST_ASSERT_EQUAL(-7, decoded.getProperty<int>("i32"));
+    TEST_ASSERT_TRUE(decoded.hasProperty<uint64_t>("u64"));   // Small values keep their width
+    TEST_ASSERT_EQUAL(-5, decoded.getProperty<int64_t>("i64"));
+  }
+
+  static void test_aborted_frame_keeps_keys(void) {
+    reset();
+    Postman::Wire::Encoder encoder(sink);
+    Postman::Wire::Decoder decoder(onField, onFrame);
+
+    failing() = true;
+    TEST_ASSERT_FALSE(encoder.encode(1, sample()));
+    failing() = false;
+
+    // The aborted frame never reached the Decoder, so its keys must be sent as literals again
+    TEST_ASSERT_TRUE(encoder.encode(2, sample()));
+    TEST_ASSERT_TRUE(decoder.feed(stream().data(), stream().size()));
+    TEST_ASSERT_EQUAL(2, frames());
+    TEST_ASSERT_EQUAL(6, fields().size());
+    TEST_ASSERT_TRUE(find("data")->bytes == "Endpoint F");
+  }
+
+  static void setup(){
+    UNITY_BEGIN();
+  }
+
+  static void finish(){
+    UNITY_END();
+  }
+
+  static void run(){
+    setup();
+
+    RUN_TEST(test_roundtrip_scalars);
+    RUN_TEST(test_interned_keys_shrink_frames);
+    RUN_TEST(test_byte_by_byte_feed);
+    RUN_TEST(test_long_value_chunks);
+    RUN_TEST(test_unknown_version);
+    RUN_TEST(test_integer_widths);
+    RUN_TEST(test_aborted_frame_keeps_keys);
+
+    finish();
+  }
+};